@@ -12,6 +12,15 @@
 #include <algorithm>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
+#include "studentData.h"
+#include "studentIndex.h"
+#include "gradeQuery.h"
+#include "studentSnapshot.h"
+#include "liveIngest.h"
+#include "resultWriter.h"
+#include "studentCommands.h"
+#include "taskStats.h"
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wmissing-noreturn"
@@ -40,217 +49,171 @@
  * valuable. Additionally, in that research paper its proven that in large datasets std::map is only better at
  * deleting things even in large instances. This should fully justify map as the best option for this task.
  *
+ * ======STORING THE DATA=======
+ * The hash map only ends up mapping names to dense ids; the grades themselves live in StudentStore as one contiguous
+ * column per subject. Every sorted index is then a vector of 32 bit ids, so a comparison while sorting or searching is
+ * two loads from the same int array instead of following two hash node pointers into different cache lines. With
+ * millions of students that difference dominates the sort.
+ *
+ * None of the indexes are sorted at startup any more. Each is built the first time a command needs it, and a short
+ * page like "biology top 10" doesn't need one at all: it's picked out of the column with a heap of ten in one pass.
+ *
  * Also, notice that int will be used throughout. This is because CPUs are the fastest at doing operations
  * on their native type, and this is usually an int type.
  */
 
-//Instead of declaring this over and over just use this
-//Using int to automatically set the optimal size
-typedef std::unordered_map<std::string, std::array<int, 5>> mainDataStruct;
-
-//Instead of making a switch statement for deciding which subject something is, use a map
-std::map<std::string, int> const subjectIndex(
-        {{"Biology",     0},
-         {"Mathematics", 1},
-         {"Chemistry",   2},
-         {"Physics",     3},
-         {"Total",       4}
-        }
-);
-
-void loadInData(mainDataStruct &studentData) {
-    //Each line consists of
-    // studentName subect grade
-    std::string studentName;
-    std::string subject;
-    std::string grade;
-    std::ifstream ifs("bigData.txt");
-    //Until end of input
-    while (ifs.peek() != std::char_traits<char>::eof()) {
-        ifs >> studentName >> subject >> grade;
-        auto iterator = studentData.find(studentName);
-        if (iterator != studentData.end()) {
-            iterator->second[subjectIndex.at(subject)] = std::stoi(grade);
+int main(int argc, char **argv) {
+    // Task1 [--legacy] [--comparison-sort] [--threads n] [--snapshot snapshotFile] [--warm] [--follow]
+    //       [--batch commandFile] [--stats-file statsFile [--stats-every seconds]] [file]
+    // --legacy goes back to the ifstream loader and --comparison-sort to building the indexes with std::sort, both are
+    // only useful for comparing against the faster versions
+    // --threads 1 loads and sorts on a single thread, the default is one thread per core
+    // --snapshot starts from snapshotFile if it's newer than file, otherwise loads file as usual and writes it
+    // --warm builds every index in the background straight after loading, rather than each one the first time a
+    // command needs it
+    // --follow keeps reading lines appended to file after loading and applies them while commands are running
+    // --batch runs every command in commandFile on all threads, prints their output in order and exits
+    // --stats-file writes what the stats command shows to statsFile every 10 seconds (or however many --stats-every
+    // says) while commands are running
+    bool legacyLoader = false;
+    bool follow = false;
+    bool warm = false;
+    bool comparisonSort = false;
+    unsigned threadCount = hardwareThreads();
+    std::string file = "bigData.txt";
+    std::string snapshotFile;
+    std::string batchFile;
+    std::string statsFile;
+    int statsEvery = 10;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--snapshot" && i + 1 < argc) {
+            snapshotFile = argv[++i];
+        } else if (std::string(argv[i]) == "--batch" && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (std::string(argv[i]) == "--stats-file" && i + 1 < argc) {
+            statsFile = argv[++i];
+        } else if (std::string(argv[i]) == "--stats-every" && i + 1 < argc) {
+            statsEvery = std::max(1, std::stoi(argv[++i]));
+        } else if (std::string(argv[i]) == "--warm") {
+            warm = true;
+        } else if (std::string(argv[i]) == "--follow") {
+            follow = true;
+        } else if (std::string(argv[i]) == "--legacy") {
+            legacyLoader = true;
+        } else if (std::string(argv[i]) == "--comparison-sort") {
+            comparisonSort = true;
+        } else if (std::string(argv[i]) == "--threads" && i + 1 < argc) {
+            threadCount = unsigned(std::max(1, std::stoi(argv[++i])));
         } else {
-            studentData[studentName] = std::array<int, 5>();
-            studentData[studentName][subjectIndex.at(subject)] = std::stoi(grade);
+            file = argv[i];
         }
     }
-    for (auto student = studentData.begin(); student != studentData.end(); student++) {
-        student->second[4] = student->second[0] + student->second[1] + student->second[2] + student->second[3];
-    }
-}
-
-class CompareKeys {
-public:
-    inline bool operator()(mainDataStruct::iterator &i, mainDataStruct::iterator &j) const {
-        return i->first < j->first;
-    }
-};
-
-class CompareIndex {
-    // As comparators get compared highly frequently by std::sort, make both of these inline as
-    // it'll give a decent speed boost
-public:
-    explicit CompareIndex(int index) : index(index) {}
-
-    inline bool operator()(mainDataStruct::iterator &i, mainDataStruct::iterator &j) const {
-        return i->second[index] > j->second[index];
-    }
-
-private:
-    int index;
-};
-
-void printStudent(mainDataStruct::iterator student) {
-    std::cout << "Name: "
-              << std::left << std::setw(12) << student->first
-              << std::left << std::setw(10) << " | Biology grade: " << student->second[0]
-              << std::setw(10) << " | Mathematics grade: " << student->second[1]
-              << std::setw(10) << " | Chemistry grade: " << student->second[2]
-              << std::setw(10) << " | Physics grade: " << student->second[3]
-              << std::setw(10) << " | Total grade: " << student->second[4]
-              << std::endl;
-}
-
-void printData(std::vector<mainDataStruct::iterator> &toPrint) {
-    for (auto i : toPrint) {
-        printStudent(i);
-    }
-}
-
-
-void printDataUntil(std::vector<mainDataStruct::iterator> &toPrint, int value, int index) {
-    for (auto i : toPrint) {
-        if (i->second[index] <= value) {
-            break;
-        }
-        printStudent(i);
-    }
-}
-
-class compareGrade {
-public:
-    explicit compareGrade(int index) : index(index) {}
-
-    inline bool operator()(mainDataStruct::iterator &i, int const & value) const {
-        return i->second[index] > value;
-    }
 
-private:
-    int index;
-};
-
-int countStudentsWithGradeAbove(std::vector<mainDataStruct::iterator> &toPrint, int value, int index) {
-    compareGrade comp{index};
-    auto iter = std::lower_bound(toPrint.begin(), toPrint.end(), value, comp);
-    return std::distance(toPrint.begin(), iter);
-}
-
-
-int main() {
     clock_t startTime = clock();
-
-    mainDataStruct studentData{};
-    loadInData(studentData);
-    int studentCount = studentData.size();
-
+    auto loadStart = std::chrono::steady_clock::now();
+
+    // These own the characters the names in studentData point at, so they're declared first to outlive it
+    MappedFile mappedInput;
+    MappedFile mappedSnapshot;
+    NameArena nameArena;
+    TaskStats stats(nameArena);
+    StudentStore studentData{};
     //Putting all the subjects first such that they match with the main data
     //Using std::vector here because we need dynamic space for adding more students, but don't need additional ways
-    //to sort.
-    std::array<std::vector<mainDataStruct::iterator>, 6> sortedData;
-    //Prevent reallocation:
-    for (auto i : sortedData) {
-        i.reserve(studentCount);
-    }
-
-    //Fill everything with iterators
-    for (int i = 0; i < 6; i++) {
-        sortedData[i].reserve(studentData.size());
+    //to sort. Every index is just the ids in some order, and none of them are built until something asks for them
+    LazyIndexes sortedIndexes(studentData, comparisonSort);
+    GradeQueryIndex queryIndex(studentData, sortedIndexes);
+    // Following starts from wherever loading stopped
+    uint64_t loadedBytes = fileStamp(file).first;
+
+    sortedDataStruct snapshotIndexes;
+    if (!snapshotFile.empty() && loadSnapshot(snapshotFile, file, mappedSnapshot, studentData, snapshotIndexes)) {
+        for (int index = 0; index < 6; index++) {
+            sortedIndexes.set(index, std::move(snapshotIndexes[index]));
+        }
+        stats.recordLoad("snapshot", LineCounts(), elapsedNanoseconds(loadStart), mappedSnapshot.size(),
+                         mappedSnapshot.size());
+        std::cout << "Loaded snapshot " << snapshotFile << std::endl;
+    } else {
+        LineCounts lineCounts;
+        if (legacyLoader) {
+            lineCounts = loadInData(studentData, nameArena, file);
+        } else {
+            try {
+                mappedInput = MappedFile(file);
+            } catch (std::runtime_error &error) {
+                std::cout << error.what() << std::endl;
+                return 1;
+            }
+            lineCounts = loadInDataParallel(studentData, mappedInput, threadCount);
+            loadedBytes = completeLinesEnd(mappedInput);
+        }
+        // The legacy loader streams the file instead of mapping it, so its size is the size it had when loading started
+        stats.recordLoad(legacyLoader ? "legacy text" : "text", lineCounts, elapsedNanoseconds(loadStart),
+                         legacyLoader ? loadedBytes : mappedInput.size(), mappedInput.size());
+        if (!snapshotFile.empty()) {
+            try {
+                writeSnapshot(snapshotFile, file, studentData, sortedIndexes.all(threadCount));
+                std::cout << "Wrote snapshot " << snapshotFile << std::endl;
+            } catch (std::runtime_error &error) {
+                std::cout << error.what() << std::endl;
+            }
+        }
     }
-
-    for (auto i = studentData.begin(); i != studentData.end(); i++) {
-        for (int j = 0; j < 6; j++) {
-            sortedData[j].emplace_back(i);
+    // Commands only ever hold this shared, appended lines are applied holding it exclusively
+    std::shared_timed_mutex storeMutex;
+    std::unique_ptr<LiveIndexes> liveIndexes;
+    std::unique_ptr<GradeFileTail> tail;
+    if (follow) {
+        // Keeping indexes up to date needs them all there to start with
+        sortedIndexes.buildAll(threadCount);
+        queryIndex.buildAll(threadCount);
+        liveIndexes.reset(new LiveIndexes(studentData, sortedIndexes, queryIndex, nameArena));
+        try {
+            tail.reset(new GradeFileTail(file, loadedBytes, *liveIndexes, storeMutex));
+        } catch (std::runtime_error &error) {
+            std::cout << error.what() << std::endl;
         }
     }
 
-    for (int i = 0; i < 5; i++) {
-        CompareIndex comp(i);
-        std::sort(sortedData[i].begin(), sortedData[i].end(), comp);
+    std::cout << "Time to insert and sort: " << double(clock() - startTime) / CLOCKS_PER_SEC << "s" << std::endl;
+    BackgroundTask warmUp;
+    if (warm) {
+        warmUp = BackgroundTask([&sortedIndexes, &queryIndex, threadCount]() {
+            sortedIndexes.buildAll(threadCount);
+            queryIndex.buildAll(threadCount);
+        });
     }
-    std::sort(sortedData[5].begin(), sortedData[5].end(), CompareKeys());
 
-    std::cout << "Time to insert and sort: " << double(clock() - startTime) / CLOCKS_PER_SEC << "s" << std::endl;
+    // Commands are read a line at a time. Output is formatted into one buffer and written out once per command
+    // (or whenever the buffer fills up), never once per row
+    StudentCommands commands(studentData, sortedIndexes, queryIndex, storeMutex, &stats);
+    std::unique_ptr<PeriodicStatsDump> statsDump;
+    if (!statsFile.empty()) {
+        auto writeStats = [&commands](ResultWriter &statsOut) { commands.execute("stats", statsOut); };
+        statsDump.reset(new PeriodicStatsDump(statsFile, std::chrono::seconds(statsEvery), writeStats));
+    }
+    if (!batchFile.empty()) {
+        std::ifstream batch(batchFile);
+        if (!batch) {
+            std::cout << "Could not open " << batchFile << std::endl;
+            return 1;
+        }
+        runBatch(commands, batch, std::cout, threadCount);
+        return 0;
+    }
 
-    std::string instruction;
-    int instructionNum;
+    ResultWriter out(&std::cout);
+    std::string line;
     while (true) {
         std::cout << ">>>>";
-        std::cin >> instruction;
-        for (int i = 0; i < 255 && instruction[i] != '\0'; i++) {
-            instruction[i] = ::tolower(instruction[i]);
+        if (!std::getline(std::cin, line)) {
+            break;
         }
-        if (instruction == "biology") {
-            printData(sortedData[0]);
-        } else if (instruction == "maths") {
-            printData(sortedData[1]);
-        } else if (instruction == "chemistry") {
-            printData(sortedData[2]);
-        } else if (instruction == "physics") {
-            printData(sortedData[3]);
-        } else if (instruction == "total") {
-            printData(sortedData[4]);
-        } else if (instruction == "names") {
-            printData(sortedData[5]);
-        } else if (instruction == "biologyuntil") {
-            std::cin >> instructionNum;
-            printDataUntil(sortedData[0], instructionNum, 0);
-        } else if (instruction == "mathsuntil") {
-            std::cin >> instructionNum;
-            printDataUntil(sortedData[1], instructionNum, 1);
-        } else if (instruction == "chemistryuntil") {
-            std::cin >> instructionNum;
-            printDataUntil(sortedData[2], instructionNum, 2);
-        } else if (instruction == "physicsuntil") {
-            std::cin >> instructionNum;
-            printDataUntil(sortedData[3], instructionNum, 3);
-        } else if (instruction == "totaluntil") {
-            std::cin >> instructionNum;
-            printDataUntil(sortedData[4], instructionNum, 4);
-        } else if (instruction == "biologycount") {
-            std::cin >> instructionNum;
-            std::cout << countStudentsWithGradeAbove(sortedData[0], instructionNum, 0)
-                      << " students have a grade above that" << std::endl;
-        } else if (instruction == "mathscount") {
-            std::cin >> instructionNum;
-            std::cout << countStudentsWithGradeAbove(sortedData[1], instructionNum, 1)
-                      << " students have a grade above that" << std::endl;
-        } else if (instruction == "chemistrycount") {
-            std::cin >> instructionNum;
-            std::cout << countStudentsWithGradeAbove(sortedData[2], instructionNum, 2)
-                      << " students have a grade above that" << std::endl;
-        } else if (instruction == "physicscount") {
-            std::cin >> instructionNum;
-            std::cout << countStudentsWithGradeAbove(sortedData[2], instructionNum, 3)
-                      << " students have a grade above that" << std::endl;
-        } else if (instruction == "totalcount") {
-            std::cin >> instructionNum;
-            std::cout << countStudentsWithGradeAbove(sortedData[3], instructionNum, 4)
-                      << " students have a grade above that" << std::endl;
-        } else if (instruction == "find") {
-            std::cin >> instruction;
-            auto student = studentData.find(instruction);
-            if (student == studentData.end()) {
-                studentData[instruction] = std::array<int, 5>();
-                student = studentData.find(instruction);
-            }
-            printStudent(student);
-        } else if (instruction == "exit") {
+        bool keepGoing = commands.execute(line, out);
+        out.flush();
+        if (!keepGoing) {
             break;
-        } else {
-            std::cout << "Sorry, that's an unrecognised command" << std::endl;
-            std::cout << "you entered: " << instruction << std::endl;
         }
     }
 }
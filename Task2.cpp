@@ -8,168 +8,274 @@
 #include <fstream>
 #include <vector>
 #include <queue>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include "graph.h"
+#include "graphFile.h"
+#include "searchQueue.h"
+#include "landmarks.h"
+#include "searchScratch.h"
+#include "allPairs.h"
+#include "search.h"
 
 
-/*
- * Given a source and target vertex, find the best path
- *
- * Output:
- *      - Number of hops for the shortest path
- *      - Total length of shortest path
- *      - Number of nodeCount added to the structure
- *      - Number of nodeCount popped from the stack
- *      - Time taken to find the shortest path
- *
- * - Iterative Search: stack
- * - Breadth first Search: queue
- * - Uniform cost Search: priority queue
- *
- * 1 mark: implementing required data structures
- * 2 marks: implementing one Search xFirstSearchAlgorithm
- * 1 mark: statistics collected
- * 1 mark: other two algorithms
- */
-
-class Search {
-public:
-    Search(int source, int target, std::string fileLocation)
-            : source(source), target(target) {
-        std::ifstream ifs(fileLocation);
-        ifs >> nodeCount;
-        for (int i = 0; i < nodeCount; i++) {
-            matrix.emplace_back();
-            matrix[i].reserve(nodeCount);
-            for (int j = 0; j < nodeCount; j++) {
-                matrix[i].push_back(0);
-            }
-        }
-
-        // This is the biggest bottleneck in the program; it takes ~33% of the program to use the
-        // >> operator. The simplest way to make it faster is to redirect to std::cin and use
-        // scanf (fscanf is actually slower than ifs), which is about ~3x as fast. However, that
-        // comes with other downsides (less secure, probably more readable to use ifs >>)
-        // and other optimisations are too complex . As such, this is accepted.
-        for (int i = 0; i < nodeCount; i++) {
-            for (int j = 0; j < nodeCount; j++) {
-                ifs >> matrix[i][j];
-            }
+// Loads graphLocation's landmarks file, or works them out and writes it if it's missing or stale
+Landmarks landmarksFor(const std::string &graphLocation, const Graph &graph, const Graph &reverse, int count,
+                       unsigned threadCount) {
+    Landmarks landmarks;
+    std::string landmarksLocation = graphLocation + ".landmarks";
+    if (!loadLandmarks(landmarksLocation, graphLocation, graph, count, landmarks)) {
+        landmarks = Landmarks(graph, reverse, count, threadCount);
+        try {
+            writeLandmarks(landmarksLocation, graphLocation, graph, landmarks);
+        } catch (std::runtime_error &error) {
+            // Only means working them out again next time
+            std::cerr << error.what() << std::endl;
         }
     }
+    return landmarks;
+}
 
-    template<class T>
-    void doSearch() {
-        clock_t startClock = clock();
-        std::vector<int> parent(nodeCount, -1);
-        std::vector<int> cost(nodeCount, std::numeric_limits<int>::max());
-        cost[source] = 0;
+// One line of a query file: the pair it asks about (-1 -1 if it isn't a pair) and its text, trailing blanks dropped
+struct BatchQuery {
+    int source;
+    int target;
+    const char *text;
+    size_t length;
+};
 
-        xFirstSearchAlgorithm<T>(parent, cost);
+// How many queries a worker takes at a time, enough that handing them out costs nothing next to the searches
+const size_t queryBlock = 256;
 
-        shortestPathLength = cost[target];
-        setShortestPath(parent);
-        timeTaken = double((clock() - startClock)) / CLOCKS_PER_SEC;
+/*
+ * Answers a file of queries, a "source target" pair on every line, with a line each of
+ *      source target length hops settled [path]
+ * where length is -1 when there's no path. A line that isn't two nodes of the graph is echoed as it is followed by
+ * "invalid" instead, so it can be found in the file. Blocks of queries go to threadCount workers that all share the
+ * graph, each searching in scratch from a pool, and the answers are written in the order of the file as soon as they're
+ * ready.
+ */
+template<class T>
+void runQueryBatch(const MappedFile &queries, std::ostream &sink, const Graph &graph, const Graph *reverse,
+                   const Landmarks *landmarks, unsigned threadCount, bool paths) {
+    std::vector<BatchQuery> pairs;
+    const char *at = queries.begin();
+    while ((at = skipBlanks(at, queries.end())) < queries.end()) {
+        const char *lineEnd = lineEndFrom(at, queries.end());
+        const char *textEnd = lineEnd;
+        while (isBlank(textEnd[-1])) {
+            textEnd--;
+        }
+        BatchQuery query{-1, -1, at, size_t(textEnd - at)};
+        const char *afterSource = scanInt(at, lineEnd, query.source);
+        if (!afterSource || !scanInt(afterSource, lineEnd, query.target)) {
+            query.source = -1;
+            query.target = -1;
+        }
+        pairs.push_back(query);
+        at = lineEnd;
     }
 
-
-    void setShortestPath(std::vector<int> &parent) {
-        // The parent is stored such from the destination the index points
-        // towards the previous node
-        int current = target;
-        while (current != source) {
-            shortestPath.insert(shortestPath.begin(), current);
-            current = parent[current];
-            hopsOnShortestPath++;
+    ScratchPool pool(graph);
+    size_t blockCount = (pairs.size() + queryBlock - 1) / queryBlock;
+    orderedParallelFor<std::string>(blockCount, threadCount, size_t(threadCount) * 4, [&](size_t block) {
+        std::unique_ptr<SearchScratch> scratch = pool.acquire();
+        std::string output;
+        for (size_t i = block * queryBlock; i < std::min(pairs.size(), (block + 1) * queryBlock); i++) {
+            int source = pairs[i].source;
+            int target = pairs[i].target;
+            if (source < 0 || source >= graph.nodeCount() || target < 0 || target >= graph.nodeCount()) {
+                output.append(pairs[i].text, pairs[i].length);
+                output += " invalid\n";
+                continue;
+            }
+            output += std::to_string(source);
+            output += ' ';
+            output += std::to_string(target);
+            Search search{source, target, graph, reverse, landmarks, scratch.get()};
+            search.doSearch<T>();
+            output += ' ';
+            output += std::to_string(search.pathLength() == unreachable ? -1 : search.pathLength());
+            output += ' ';
+            output += std::to_string(search.hops());
+            output += ' ';
+            output += std::to_string(search.settledCount());
+            if (paths) {
+                for (int node : search.path()) {
+                    output += ' ';
+                    output += std::to_string(node);
+                }
+            }
+            output += '\n';
         }
-        shortestPath.insert(shortestPath.begin(), current);
-    }
+        pool.release(std::move(scratch));
+        return output;
+    }, [&sink](size_t, const std::string &output) {
+        sink.write(output.data(), std::streamsize(output.size()));
+    });
+    sink.flush();
+}
 
-    void printData() {
-        std::cout << "Shortest path: ";
-        printPath();
-        std::cout << std::endl
-                  << "Number of hops on shortest path: " << hopsOnShortestPath << std::endl
-                  << "Shortest path length: " << shortestPathLength << std::endl
-                  << "Nodes added: " << nodesPushed << std::endl
-                  << "Nodes popped: " << nodesPopped << std::endl
-                  << "Time taken: " << timeTaken << std::endl;
-    }
+// All pairs uses Floyd-Warshall once there's an edge for every this many pairs of nodes
+const uint64_t allPairsDensity = 8;
 
-private:
-    void printPath() {
-        for (auto i : shortestPath) {
-            std::cout << i << " ";
+int main(int argc, char **argv) {
+    // Task2 [--legacy] [--heap] [--landmarks k] [--delta d] [--threads n] [--batch queries [--search s] [--paths]]
+    //       [--all-pairs out [--next-hops] [--method m]] [file]
+    // A binary graph file (from graphToBinary) is mapped and used in place. --legacy reads a text file with the old
+    // stream based reader instead of mapping it and parsing on every core. --heap makes uniform cost search use the
+    // indexed heap even when the weights are light enough for the bucket queue. A* uses k landmarks (8 by default),
+    // which are worked out the first time and kept in file.landmarks after that. Delta stepping uses buckets d wide,
+    // the graph's mean edge weight by default.
+    // --batch answers every pair in queries (see runQueryBatch) instead of the one demo query, with search s being
+    // uniform, bidirectional (the default) or astar, and --paths adds each path to its line.
+    // --all-pairs writes the distance between every pair of nodes to out instead (see allPairs.h), with each path's
+    // next hop as well given --next-hops. Method m is floyd, dijkstra or auto (the default), which picks by density
+    std::string file = "slideMatrix.txt";
+    bool legacyLoader = false;
+    bool heapQueue = false;
+    int landmarkCount = 8;
+    int delta = 0;
+    std::string batchFile;
+    std::string searchMode = "bidirectional";
+    bool paths = false;
+    std::string allPairsFile;
+    bool nextHops = false;
+    std::string method = "auto";
+    unsigned threadCount = hardwareThreads();
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--legacy") {
+            legacyLoader = true;
+        } else if (std::string(argv[i]) == "--heap") {
+            heapQueue = true;
+        } else if (std::string(argv[i]) == "--delta" && i + 1 < argc) {
+            delta = std::max(1, std::stoi(argv[++i]));
+        } else if (std::string(argv[i]) == "--landmarks" && i + 1 < argc) {
+            landmarkCount = std::max(1, std::stoi(argv[++i]));
+        } else if (std::string(argv[i]) == "--batch" && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (std::string(argv[i]) == "--search" && i + 1 < argc) {
+            searchMode = argv[++i];
+        } else if (std::string(argv[i]) == "--paths") {
+            paths = true;
+        } else if (std::string(argv[i]) == "--all-pairs" && i + 1 < argc) {
+            allPairsFile = argv[++i];
+        } else if (std::string(argv[i]) == "--next-hops") {
+            nextHops = true;
+        } else if (std::string(argv[i]) == "--method" && i + 1 < argc) {
+            method = argv[++i];
+        } else if (std::string(argv[i]) == "--threads" && i + 1 < argc) {
+            threadCount = unsigned(std::max(1, std::stoi(argv[++i])));
+        } else {
+            file = argv[i];
         }
     }
 
-    //Due to someone defining these functions
-    int popNodeFromHeap(std::queue<int> &queueMode) {
-        return queueMode.front();
+    Graph graph;
+    try {
+        graph = legacyLoader ? loadGraphStream(file) : openGraph(file, threadCount);
+    } catch (std::runtime_error &error) {
+        std::cout << error.what() << std::endl;
+        return 1;
     }
+    bool bucketQueue = !heapQueue && graph.weightBound() <= bucketQueueWeightLimit;
 
-    int popNodeFromHeap(std::stack<int> &stackMode) {
-        return stackMode.top();
-    }
-
-    int popNodeFromHeap(std::priority_queue<int> &priorityQueueMode) {
-        return priorityQueueMode.top();
+    if (!allPairsFile.empty()) {
+        // Floyd-Warshall's n^3 against n Dijkstras of about m each, with its inner loop being several times cheaper
+        if (method == "auto") {
+            method = graph.edgeCount() * allPairsDensity >= uint64_t(graph.nodeCount()) * graph.nodeCount() ? "floyd"
+                                                                                                          : "dijkstra";
+        }
+        if (method != "floyd" && method != "dijkstra") {
+            std::cout << "Unknown method " << method << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        try {
+            AllPairsWriter out(allPairsFile, graph.nodeCount(), nextHops);
+            if (method == "floyd") {
+                allPairsFloydWarshall(graph, threadCount, nextHops, out);
+            } else {
+                allPairsDijkstra(graph, threadCount, nextHops, out);
+            }
+            out.finish();
+        } catch (std::runtime_error &error) {
+            std::cout << error.what() << std::endl;
+            return 1;
+        }
+        std::cout << "All pairs (" << method << ") of " << graph.nodeCount() << " nodes written to " << allPairsFile
+                  << " in " << double(elapsedNanoseconds(start)) / 1e9 << "s" << std::endl;
+        return 0;
     }
 
-    template<class T>
-    void xFirstSearchAlgorithm(std::vector<int> &parent, std::vector<int> &cost) {
-        int current; // Don't replace the space over and over
-        T heap;
-        heap.push(source);
-        while (!heap.empty()) {
-            current = popNodeFromHeap(heap);
-            heap.pop();
-            nodesPopped++;
-
-            if (current != target) {
-                for (int neigh = 0; neigh < nodeCount; neigh++) {
-                    if (matrix[current][neigh] == 0) continue; // Skip no links
-                    if (cost[neigh] > cost[current] + matrix[current][neigh]) {
-                        cost[neigh] = cost[current] + matrix[current][neigh];
-                        parent[neigh] = current;
-                        heap.push(neigh);
-                        nodesPushed++;
-                    }
-                }
+    if (!batchFile.empty()) {
+        MappedFile queries;
+        try {
+            queries = MappedFile(batchFile);
+        } catch (std::runtime_error &error) {
+            std::cout << error.what() << std::endl;
+            return 1;
+        }
+        Graph reverse;
+        Landmarks landmarks;
+        if (searchMode == "uniform") {
+            if (bucketQueue) {
+                runQueryBatch<BucketQueue>(queries, std::cout, graph, nullptr, nullptr, threadCount, paths);
+            } else {
+                runQueryBatch<IndexedHeap<>>(queries, std::cout, graph, nullptr, nullptr, threadCount, paths);
             }
+        } else if (searchMode == "bidirectional") {
+            reverse = reversed(graph);
+            runQueryBatch<Bidirectional>(queries, std::cout, graph, &reverse, nullptr, threadCount, paths);
+        } else if (searchMode == "astar") {
+            reverse = reversed(graph);
+            landmarks = landmarksFor(file, graph, reverse, landmarkCount, threadCount);
+            runQueryBatch<LandmarkAStar>(queries, std::cout, graph, &reverse, &landmarks, threadCount, paths);
+        } else {
+            std::cout << "Unknown search " << searchMode << std::endl;
+            return 1;
         }
+        return 0;
     }
 
-    int source;
-    int target;
-    int nodeCount;
-
-    std::vector<std::vector<int>> matrix;
-
-    std::vector<int> shortestPath;
-    int hopsOnShortestPath = 0;
-    int shortestPathLength = std::numeric_limits<short>::max();
-    int nodesPushed = 0;
-    int nodesPopped = 0;
-    double timeTaken;
-};
-
-
-int main(int argc, char **argv) {
-    std::string file;
-    if (argv[1]) {
-        file = std::string(argv[1]);
-    } else {
-        file = "slideMatrix.txt";
-    }
     std::cout << "==============Depth First Search============" << std::endl;
-    Search search{0, 4, file};
-    search.doSearch<std::stack<int>>();
-    search.printData();
+    Search depthFirst{0, 4, graph};
+    depthFirst.doSearch<std::stack<int>>();
+    depthFirst.printData();
     std::cout << "==============Breadth First Search============" << std::endl;
-    search = Search(0, 4, file);
-    search.doSearch<std::stack<int>>();
-    search.printData();
+    Search breadthFirst{0, 4, graph};
+    breadthFirst.doSearch<std::queue<int>>();
+    breadthFirst.printData();
+    Graph reverse = reversed(graph);
+    std::cout << "=========Fewest Hops Search=========" << std::endl;
+    Search fewestHops{0, 4, graph, &reverse};
+    fewestHops.setThreadCount(threadCount);
+    fewestHops.doSearch<FewestHops>();
+    fewestHops.printData();
     std::cout << "=========Uniform First Search=========" << std::endl;
-    search = Search(0, 4, file);
-    search.doSearch<std::stack<int>>();
-    search.printData();
+    Search uniformCost{0, 4, graph};
+    if (bucketQueue) {
+        uniformCost.doSearch<BucketQueue>();
+    } else {
+        uniformCost.doSearch<IndexedHeap<>>();
+    }
+    uniformCost.printData();
+    std::cout << "=========Delta Stepping Search=========" << std::endl;
+    Search deltaStepping{0, 4, graph};
+    deltaStepping.setThreadCount(threadCount);
+    deltaStepping.setDelta(delta);
+    deltaStepping.doSearch<DeltaStepping>();
+    deltaStepping.printData(&uniformCost);
+
+    Landmarks landmarks = landmarksFor(file, graph, reverse, landmarkCount, threadCount);
+    std::cout << "=========Bidirectional Search=========" << std::endl;
+    Search bidirectional{0, 4, graph, &reverse};
+    bidirectional.doSearch<Bidirectional>();
+    bidirectional.printData(&uniformCost);
+    std::cout << "=========A* Search=========" << std::endl;
+    Search aStar{0, 4, graph, &reverse, &landmarks};
+    aStar.doSearch<LandmarkAStar>();
+    aStar.printData(&uniformCost);
 }
\ No newline at end of file
@@ -0,0 +1,262 @@
+#ifndef PROJECT4_ALLPAIRS_H
+#define PROJECT4_ALLPAIRS_H
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#include "parallel.h"
+#include "graph.h"
+#include "searchQueue.h"
+
+/*
+ * All pairs file, the distance from every node to every other and optionally the first hop of each of those paths.
+ *
+ * Layout (native byte order):
+ *      AllPairsHeader
+ *      then for every node s in order:
+ *          int32_t distance[nodeCount]  from s to every node, -1 where there's no path
+ *          int32_t nextHop[nodeCount]   only with hasNextHops: the node after s on the way there, -1 if there's none
+ *
+ * A row at a time is what both ways of working the distances out produce, so a file can be written without ever
+ * holding the whole matrix, and read back a row at a time by seeking to it.
+ */
+struct AllPairsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t hasNextHops;
+    uint32_t unused;
+};
+
+const char allPairsMagic[8]{'P', '4', 'A', 'P', 'S', 'P', '\0', '\0'};
+const uint32_t allPairsVersion = 1;
+
+/*
+ * Writes the rows of an all pairs file in order, into a temporary name that's renamed into place by finish. Throws
+ * std::runtime_error if it can't be written.
+ */
+class AllPairsWriter {
+public:
+    AllPairsWriter(const std::string &fileLocation, int nodeCount, bool nextHops)
+            : fileLocation(fileLocation), temporary(fileLocation + ".tmp"), nodeCount(nodeCount), nextHops(nextHops),
+              ofs(temporary, std::ios::binary | std::ios::trunc) {
+        if (!ofs) {
+            throw std::runtime_error("Could not write " + temporary);
+        }
+        AllPairsHeader header{};
+        std::memcpy(header.magic, allPairsMagic, sizeof(header.magic));
+        header.version = allPairsVersion;
+        header.nodeCount = uint32_t(nodeCount);
+        header.hasNextHops = nextHops ? 1 : 0;
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        row.resize(size_t(nodeCount));
+    }
+
+    ~AllPairsWriter() {
+        if (!finished) {
+            ofs.close();
+            std::remove(temporary.c_str());
+        }
+    }
+
+    AllPairsWriter(const AllPairsWriter &) = delete;
+
+    AllPairsWriter &operator=(const AllPairsWriter &) = delete;
+
+    // nodeCount distances (anything at or past farthest is no path) and, with next hops, nodeCount of those
+    void writeRow(const int *distances, int farthest, const int *hops) {
+        for (int node = 0; node < nodeCount; node++) {
+            row[node] = distances[node] >= farthest ? -1 : distances[node];
+        }
+        ofs.write(reinterpret_cast<const char *>(row.data()), std::streamsize(row.size() * sizeof(int)));
+        if (nextHops) {
+            ofs.write(reinterpret_cast<const char *>(hops), std::streamsize(row.size() * sizeof(int)));
+        }
+    }
+
+    void finish() {
+        ofs.close();
+        if (!ofs || std::rename(temporary.c_str(), fileLocation.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write " + fileLocation);
+        }
+        finished = true;
+    }
+
+private:
+    std::string fileLocation;
+    std::string temporary;
+    int nodeCount;
+    bool nextHops;
+    std::ofstream ofs;
+    std::vector<int> row;
+    bool finished = false;
+};
+
+/*
+ * Dijkstra from every node on threadCount threads, each row handed to out in order as soon as it's ready. Every
+ * search only reads the graph, so they share it, and each costs O(m + n) with a bucket queue, which is what makes
+ * this the way to go for sparse graphs: n of them is far less than Floyd-Warshall's n^3 when m is far less than n^2.
+ */
+inline void allPairsDijkstra(const Graph &graph, unsigned threadCount, bool nextHops, AllPairsWriter &out) {
+    struct Row {
+        std::vector<int> distance;
+        std::vector<int> hops;
+    };
+    bool buckets = graph.weightBound() <= bucketQueueWeightLimit;
+    orderedParallelFor<Row>(size_t(graph.nodeCount()), threadCount, size_t(threadCount) * 4, [&](size_t source) {
+        Row row;
+        std::vector<char> settled;
+        std::vector<int> *hops = nextHops ? &row.hops : nullptr;
+        if (buckets) {
+            BucketQueue queue(graph.weightBound());
+            shortestFrom(graph, int(source), queue, row.distance, settled, hops);
+        } else {
+            IndexedHeap<> queue(graph.nodeCount());
+            shortestFrom(graph, int(source), queue, row.distance, settled, hops);
+        }
+        return row;
+    }, [&](size_t, const Row &row) {
+        out.writeRow(row.distance.data(), unreachable, row.hops.data());
+    });
+}
+
+// Floyd-Warshall works on blocks of this many rows and columns, three of which fit in a core's L1 and L2 together
+const int floydBlock = 64;
+// No path, half of the largest int so that adding two of them can't overflow
+const int floydInfinity = std::numeric_limits<int>::max() / 2;
+
+/*
+ * One block's share of Floyd-Warshall for the k of another block: c[i][j] = min(c[i][j], a[i][k] + b[k][j]) over
+ * every k, i and j of the block, where all three point into the same matrix with rows stride apart. When c improves
+ * through k the path goes the way the one to k went, so its next hop becomes a's next hop to k.
+ *
+ * The j loop is SIMD: with SSE2 four sums are compared at once and the smaller ones (and their hops) blended in with
+ * masks, SSE4.1 has a min instruction for when there are no hops to keep.
+ */
+template<bool NextHops>
+void relaxBlock(int *c, const int *a, const int *b, int *cHops, const int *aHops, size_t stride) {
+    for (int k = 0; k < floydBlock; k++) {
+        const int *bRow = b + size_t(k) * stride;
+        for (int i = 0; i < floydBlock; i++) {
+            int toK = a[size_t(i) * stride + k];
+            if (toK >= floydInfinity) {
+                continue;
+            }
+            int *cRow = c + size_t(i) * stride;
+            int *hopRow = NextHops ? cHops + size_t(i) * stride : nullptr;
+            int hop = NextHops ? aHops[size_t(i) * stride + k] : 0;
+            int j = 0;
+#ifdef __SSE2__
+            __m128i through = _mm_set1_epi32(toK);
+            __m128i hops = _mm_set1_epi32(hop);
+            for (; j + 4 <= floydBlock; j += 4) {
+                __m128i sum = _mm_add_epi32(through, _mm_loadu_si128(reinterpret_cast<const __m128i *>(bRow + j)));
+                __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cRow + j));
+                if (NextHops) {
+                    __m128i shorter = _mm_cmplt_epi32(sum, current);
+                    current = _mm_or_si128(_mm_and_si128(shorter, sum), _mm_andnot_si128(shorter, current));
+                    __m128i oldHops = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hopRow + j));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(hopRow + j),
+                                     _mm_or_si128(_mm_and_si128(shorter, hops), _mm_andnot_si128(shorter, oldHops)));
+                } else {
+#ifdef __SSE4_1__
+                    current = _mm_min_epi32(current, sum);
+#else
+                    __m128i shorter = _mm_cmplt_epi32(sum, current);
+                    current = _mm_or_si128(_mm_and_si128(shorter, sum), _mm_andnot_si128(shorter, current));
+#endif
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(cRow + j), current);
+            }
+#endif
+            for (; j < floydBlock; j++) {
+                int sum = toK + bRow[j];
+                if (sum < cRow[j]) {
+                    cRow[j] = sum;
+                    if (NextHops) {
+                        hopRow[j] = hop;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Floyd-Warshall over graph as an adjacency matrix, blocked so every pass over k works on cache sized tiles. For each
+ * diagonal block kb: the diagonal block itself first, then the rest of its block row and block column (which only
+ * need the diagonal), then every other block (which only needs those), the last two steps spread over threadCount
+ * threads. O(n^3), but branch free, SIMD and in cache, which beats n Dijkstras once the graph is dense.
+ */
+inline void allPairsFloydWarshall(const Graph &graph, unsigned threadCount, bool nextHops, AllPairsWriter &out) {
+    int nodeCount = graph.nodeCount();
+    size_t blocks = (size_t(nodeCount) + floydBlock - 1) / floydBlock;
+    size_t stride = blocks * floydBlock;
+    std::vector<int> distance(stride * stride, floydInfinity);
+    std::vector<int> hops(nextHops ? stride * stride : 0, -1);
+    for (size_t node = 0; node < stride; node++) {
+        distance[node * stride + node] = 0;
+    }
+    for (int node = 0; node < nodeCount; node++) {
+        for (uint64_t edge = graph.firstEdge(node); edge < graph.lastEdge(node); edge++) {
+            size_t at = size_t(node) * stride + graph.target(edge);
+            if (graph.weight(edge) < distance[at]) {
+                distance[at] = graph.weight(edge);
+                if (nextHops) {
+                    hops[at] = graph.target(edge);
+                }
+            }
+        }
+    }
+
+    auto relax = [&](size_t ib, size_t jb, size_t kb) {
+        size_t c = ib * floydBlock * stride + jb * floydBlock;
+        size_t a = ib * floydBlock * stride + kb * floydBlock;
+        size_t b = kb * floydBlock * stride + jb * floydBlock;
+        if (nextHops) {
+            relaxBlock<true>(&distance[c], &distance[a], &distance[b], &hops[c], &hops[a], stride);
+        } else {
+            relaxBlock<false>(&distance[c], &distance[a], &distance[b], nullptr, nullptr, stride);
+        }
+    };
+    unsigned workers = std::max(1u, std::min(threadCount, unsigned(blocks)));
+    for (size_t kb = 0; kb < blocks; kb++) {
+        relax(kb, kb, kb);
+        runOnThreads(workers, [&](unsigned worker) {
+            for (size_t other = worker; other < blocks; other += workers) {
+                if (other != kb) {
+                    relax(kb, other, kb);
+                    relax(other, kb, kb);
+                }
+            }
+        });
+        runOnThreads(workers, [&](unsigned worker) {
+            for (size_t ib = worker; ib < blocks; ib += workers) {
+                for (size_t jb = 0; jb < blocks && ib != kb; jb++) {
+                    if (jb != kb) {
+                        relax(ib, jb, kb);
+                    }
+                }
+            }
+        });
+    }
+
+    for (int node = 0; node < nodeCount; node++) {
+        out.writeRow(&distance[size_t(node) * stride], floydInfinity, nextHops ? &hops[size_t(node) * stride] : nullptr);
+    }
+}
+
+#endif //PROJECT4_ALLPAIRS_H
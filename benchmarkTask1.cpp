@@ -0,0 +1,297 @@
+//
+// Benchmarks for the Task1 load, index and query paths.
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include "mappedFile.h"
+#include "studentData.h"
+#include "studentIndex.h"
+#include "nameIndex.h"
+#include "gradeQuery.h"
+#include "liveIngest.h"
+#include "resultWriter.h"
+#include "studentCommands.h"
+
+/*
+ * Every phase is timed separately on a fresh copy of the data in each run, and the runs are summarised as percentiles
+ * so a noisy run doesn't hide or fake a regression. Queries are timed one at a time and summarised the same way.
+ *
+ * Phases that exist in two versions (the std::sort builders next to the counting/radix ones, std::map and
+ * std::unordered_map on std::string next to the StudentStore) are both timed, which is how the choices argued for in
+ * the Task1 header comment can be checked against real numbers.
+ */
+
+struct Measurement {
+    std::string phase;
+    // "ms" for whole phases, "ns" for single queries
+    std::string unit;
+    // How many lines, students or queries one sample covers, for the throughput
+    size_t items;
+    std::vector<double> samples;
+};
+
+class Benchmark {
+public:
+    Measurement &measurement(const std::string &phase, const std::string &unit, size_t items) {
+        for (auto &m : measurements) {
+            if (m.phase == phase) {
+                return m;
+            }
+        }
+        measurements.push_back({phase, unit, items, {}});
+        return measurements.back();
+    }
+
+    // Times work once as a sample of phase, in milliseconds
+    template<class Work>
+    void time(const std::string &phase, size_t items, Work work) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        measurement(phase, "ms", items).samples.push_back(elapsed.count());
+    }
+
+    // Times every query on its own, in nanoseconds
+    template<class Query>
+    void timeEach(const std::string &phase, size_t count, Query query) {
+        Measurement &m = measurement(phase, "ns", 1);
+        for (size_t i = 0; i < count; i++) {
+            auto start = std::chrono::steady_clock::now();
+            query(i);
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            m.samples.push_back(elapsed.count());
+        }
+    }
+
+    void report(std::ostream &out, bool json) {
+        if (json) {
+            out << "[\n";
+        } else {
+            out << "phase,unit,items,samples,min,p50,p90,p99,max,items_per_second\n";
+        }
+        for (size_t i = 0; i < measurements.size(); i++) {
+            Measurement &m = measurements[i];
+            std::sort(m.samples.begin(), m.samples.end());
+            double p50 = percentileOf(m.samples, 50);
+            double perSecond = p50 > 0 ? double(m.items) / (p50 / (m.unit == "ms" ? 1e3 : 1e9)) : 0;
+            if (json) {
+                out << "  {\"phase\": \"" << m.phase << "\", \"unit\": \"" << m.unit << "\", \"items\": " << m.items
+                    << ", \"samples\": " << m.samples.size() << ", \"min\": " << m.samples.front()
+                    << ", \"p50\": " << p50 << ", \"p90\": " << percentileOf(m.samples, 90)
+                    << ", \"p99\": " << percentileOf(m.samples, 99) << ", \"max\": " << m.samples.back()
+                    << ", \"items_per_second\": " << perSecond << "}" << (i + 1 < measurements.size() ? "," : "")
+                    << '\n';
+            } else {
+                out << m.phase << ',' << m.unit << ',' << m.items << ',' << m.samples.size() << ','
+                    << m.samples.front() << ',' << p50 << ',' << percentileOf(m.samples, 90) << ','
+                    << percentileOf(m.samples, 99) << ',' << m.samples.back() << ',' << perSecond << '\n';
+            }
+        }
+        if (json) {
+            out << "]\n";
+        }
+    }
+
+private:
+    // Nearest rank, samples sorted
+    static double percentileOf(const std::vector<double> &samples, double p) {
+        size_t rank = size_t(p / 100 * double(samples.size()) + 0.999999);
+        return samples[std::min(samples.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+
+    std::vector<Measurement> measurements;
+};
+
+/*
+ * Same data myGenData makes: students named 0 to studentCount - 1, one line per subject with a grade below 100, every
+ * line shuffled. Returns how many lines were written.
+ */
+size_t generateData(const std::string &fileLocation, int studentCount, unsigned seed) {
+    static const char *const subjects[4]{"Physics", "Biology", "Mathematics", "Chemistry"};
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> lines(size_t(studentCount) * 4);
+    for (size_t i = 0; i < lines.size(); i++) {
+        lines[i] = uint32_t(i);
+    }
+    std::shuffle(lines.begin(), lines.end(), rng);
+    std::vector<uint8_t> grades(lines.size());
+    for (auto &grade : grades) {
+        grade = uint8_t(rng() % 100);
+    }
+
+    std::ofstream ofs(fileLocation, std::ios::trunc);
+    std::string buffer;
+    for (uint32_t line : lines) {
+        buffer += std::to_string(line / 4);
+        buffer += ' ';
+        buffer += subjects[line % 4];
+        buffer += ' ';
+        buffer += std::to_string(int(grades[line]));
+        buffer += '\n';
+        if (buffer.size() >= 1 << 20) {
+            ofs << buffer;
+            buffer.clear();
+        }
+    }
+    ofs << buffer;
+    return lines.size();
+}
+
+int main(int argc, char **argv) {
+    // benchmarkTask1 [--students n] [--runs r] [--queries q] [--until-queries u] [--threads t] [--seed s] [--json]
+    //                [--keep] [--file dataFile]
+    // Writes a generated data file (removed afterwards unless --keep), runs every phase r times and prints one CSV
+    // (or JSON) row per phase with percentiles across the runs
+    int studentCount = 100000;
+    int runs = 5;
+    size_t queryCount = 10000;
+    size_t untilCount = 50;
+    unsigned threadCount = hardwareThreads();
+    unsigned seed = 1;
+    bool json = false;
+    bool keep = false;
+    std::string file = "benchmarkTask1Data.txt";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--students" && i + 1 < argc) {
+            studentCount = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--queries" && i + 1 < argc) {
+            queryCount = size_t(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--until-queries" && i + 1 < argc) {
+            untilCount = size_t(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = unsigned(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = unsigned(std::stoul(argv[++i]));
+        } else if (arg == "--file" && i + 1 < argc) {
+            file = argv[++i];
+        } else if (arg == "--json") {
+            json = true;
+        } else if (arg == "--keep") {
+            keep = true;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    Benchmark benchmark;
+    size_t lineCount = 0;
+    benchmark.time("generate", size_t(studentCount) * 4, [&]() {
+        lineCount = generateData(file, studentCount, seed);
+    });
+    MappedFile mapped;
+    try {
+        mapped = MappedFile(file);
+    } catch (std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    StudentStore store;
+    for (int run = 0; run < runs; run++) {
+        std::vector<GradeUpdate> parsed;
+        benchmark.time("parse", lineCount, [&]() {
+            parsed.reserve(lineCount);
+            forEachGradeLine(mapped.begin(), mapped.end(), [&parsed](NameView name, int subject, int grade) {
+                parsed.push_back({name, subject, grade});
+            });
+        });
+
+        store = StudentStore();
+        benchmark.time("insert StudentStore", lineCount, [&]() {
+            for (auto &line : parsed) {
+                store.setGrade(store.findOrAdd(line.name), line.subject, line.grade);
+            }
+        });
+        benchmark.time("totals", store.size(), [&]() { store.computeTotals(); });
+
+        // The containers the original Task1 weighed up, keyed on std::string the way it first did
+        benchmark.time("insert std::map<string>", lineCount, [&]() {
+            std::map<std::string, std::array<int, 4>> table;
+            for (auto &line : parsed) {
+                table[line.name.str()][line.subject] = line.grade;
+            }
+        });
+        benchmark.time("insert std::unordered_map<string>", lineCount, [&]() {
+            std::unordered_map<std::string, std::array<int, 4>> table;
+            for (auto &line : parsed) {
+                table[line.name.str()][line.subject] = line.grade;
+            }
+        });
+
+        benchmark.time("load mapped", lineCount, [&]() {
+            StudentStore loaded;
+            loadInDataMapped(loaded, mapped);
+        });
+        benchmark.time("load parallel", lineCount, [&]() {
+            StudentStore loaded;
+            loadInDataParallel(loaded, mapped, threadCount);
+        });
+
+        for (int index = 0; index < 6; index++) {
+            std::string name = index == namesIndex ? "names" : subjectNames[index];
+            benchmark.time("index " + name, store.size(), [&]() { buildIndex(store, index); });
+            benchmark.time("index " + name + " std::sort", store.size(), [&]() {
+                buildIndexComparison(store, index);
+            });
+        }
+        benchmark.time("index all threaded", store.size(), [&]() {
+            sortedDataStruct sortedData;
+            buildIndexes(store, sortedData, threadCount);
+        });
+    }
+
+    // Queries run against the last run's store, with every index built up front so only the query itself is timed
+    LazyIndexes indexes(store);
+    GradeQueryIndex queryIndex(store, indexes);
+    indexes.buildAll(threadCount);
+    queryIndex.buildAll(threadCount);
+    std::mt19937 rng(seed + 1);
+    std::vector<std::string> names(queryCount);
+    std::vector<int> subjects(queryCount);
+    std::vector<int> thresholds(queryCount);
+    for (size_t i = 0; i < queryCount; i++) {
+        // A tenth of the lookups miss
+        names[i] = std::to_string(rng() % (uint32_t(studentCount) + uint32_t(studentCount) / 10 + 1));
+        subjects[i] = int(rng() % 5);
+        thresholds[i] = int(rng() % 100) * (subjects[i] == 4 ? 4 : 1);
+    }
+    StudentId found = 0;
+    benchmark.timeEach("find hash", queryCount, [&](size_t i) {
+        found += store.find(NameView(names[i])) != StudentStore::notFound;
+    });
+    benchmark.timeEach("find sorted names", queryCount, [&](size_t i) {
+        found += indexes.names().find(NameView(names[i])) != StudentStore::notFound;
+    });
+    benchmark.timeEach("count histogram", queryCount, [&](size_t i) {
+        found += queryIndex.countAbove(subjects[i], thresholds[i]);
+    });
+    benchmark.timeEach("count binary search", queryCount, [&](size_t i) {
+        found += StudentId(countStudentsWithGradeAbove(store, indexes.get(subjects[i]), thresholds[i], subjects[i]));
+    });
+    ResultWriter out;
+    benchmark.timeEach("until", std::min(untilCount, queryCount), [&](size_t i) {
+        printDataUntil(out, store, indexes.get(subjects[i]), thresholds[i], subjects[i]);
+        out.clear();
+    });
+
+    benchmark.report(std::cout, json);
+    // Keeps the lookups from being optimised away
+    std::cerr << found << " matched" << std::endl;
+    if (!keep) {
+        std::remove(file.c_str());
+    }
+    return 0;
+}
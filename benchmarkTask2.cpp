@@ -0,0 +1,250 @@
+//
+// Benchmarks for the Task2 searches on generated graphs.
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sys/resource.h>
+#include "graph.h"
+#include "graphGenerator.h"
+#include "landmarks.h"
+#include "searchScratch.h"
+#include "search.h"
+
+/*
+ * Graphs are made in memory the way gengraph makes them (see graphGenerator.h), at every size asked for and with the
+ * same average degree or density, so a run gives one scaling curve per search. Every search answers the same random
+ * source and target pairs, each timed on its own, and is summarised as latency percentiles plus the mean of what
+ * Search counts per query. Setting up (generating, building the CSR arrays, reversing, landmarks) is timed as phases
+ * of one sample.
+ *
+ * The queue and stack searches relax and re-push until nothing improves, which on a big graph takes far longer than
+ * everything else put together, so they're left out above a size limit.
+ */
+
+struct Measurement {
+    std::string phase;
+    // One per query, or one for a setup phase, in microseconds
+    std::vector<double> samples;
+    // Totals over the samples
+    uint64_t reached = 0;
+    uint64_t pushed = 0;
+    uint64_t popped = 0;
+    uint64_t settled = 0;
+    uint64_t relaxations = 0;
+    uint64_t scanned = 0;
+    // The process's peak resident memory once the phase was over
+    long peakKilobytes = 0;
+};
+
+// The most memory the process has had resident so far, in kilobytes
+long peakKilobytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+class Benchmark {
+public:
+    Measurement &measurement(const std::string &phase) {
+        for (auto &m : measurements) {
+            if (m.phase == phase) {
+                return m;
+            }
+        }
+        measurements.push_back({phase, {}});
+        return measurements.back();
+    }
+
+    // Times work once as phase
+    template<class Work>
+    void time(const std::string &phase, Work work) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        Measurement &m = measurement(phase);
+        m.samples.push_back(elapsed.count());
+        m.peakKilobytes = peakKilobytes();
+    }
+
+    // Times a doSearch<T> for every pair, all in the same scratch like a batch of queries
+    template<class T>
+    void timeSearches(const std::string &phase, const std::vector<std::pair<int, int>> &pairs, const Graph &graph,
+                      const Graph *reverse, const Landmarks *landmarks, SearchScratch &scratch,
+                      unsigned threadCount) {
+        Measurement &m = measurement(phase);
+        for (auto &pair : pairs) {
+            Search search{pair.first, pair.second, graph, reverse, landmarks, &scratch};
+            search.setThreadCount(threadCount);
+            auto start = std::chrono::steady_clock::now();
+            search.doSearch<T>();
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            m.samples.push_back(elapsed.count());
+            m.reached += search.pathLength() != unreachable;
+            m.pushed += uint64_t(search.pushedCount());
+            m.popped += uint64_t(search.poppedCount());
+            m.settled += uint64_t(search.settledCount());
+            m.relaxations += search.relaxationCount();
+            m.scanned += search.scannedCount();
+        }
+        m.peakKilobytes = peakKilobytes();
+    }
+
+    static void header(std::ostream &out) {
+        out << "nodes,edges,phase,samples,reached,min_us,p50_us,p90_us,p99_us,max_us,mean_us,pushed,popped,settled,"
+               "relaxations,edges_scanned,peak_rss_kb\n";
+    }
+
+    // One row per phase for the graph just measured, which is then forgotten, so rows come out as each size finishes
+    void report(std::ostream &out, int nodeCount, uint64_t edgeCount) {
+        for (auto &m : measurements) {
+            std::sort(m.samples.begin(), m.samples.end());
+            double count = double(m.samples.size());
+            double total = 0;
+            for (double sample : m.samples) {
+                total += sample;
+            }
+            out << nodeCount << ',' << edgeCount << ',' << m.phase << ',' << m.samples.size() << ',' << m.reached
+                << ',' << m.samples.front() << ',' << percentileOf(m.samples, 50) << ','
+                << percentileOf(m.samples, 90) << ',' << percentileOf(m.samples, 99) << ',' << m.samples.back()
+                << ',' << total / count << ',' << double(m.pushed) / count << ',' << double(m.popped) / count << ','
+                << double(m.settled) / count << ',' << double(m.relaxations) / count << ','
+                << double(m.scanned) / count << ',' << m.peakKilobytes << '\n';
+        }
+        out.flush();
+        measurements.clear();
+    }
+
+private:
+    // Nearest rank, samples sorted
+    static double percentileOf(const std::vector<double> &samples, double p) {
+        size_t rank = size_t(p / 100 * double(samples.size()) + 0.999999);
+        return samples[std::min(samples.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+
+    std::vector<Measurement> measurements;
+};
+
+// Splits "a,b,c" at the commas
+std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int main(int argc, char **argv) {
+    // benchmarkTask2 [--nodes n[,n...]] [--degree d | --density p] [--queries q] [--searches s[,s...]]
+    //                [--label-correcting-limit l] [--landmarks k] [--threads t] [--seed s]
+    // Generates a graph of every size n (1000, 10000 and 100000 by default) with an average of d edges leaving each
+    // node (8 by default), or with a fraction p of all pairs of nodes joined like gengraph's dense graphs, and prints a
+    // CSV row per phase and search. Searches are dfs, bfs, hops, uniform, heap, delta, bidirectional and astar, all of
+    // them by default, with dfs and bfs only on graphs of up to l nodes (2000 by default).
+    // Peak memory is the process's, so it only grows from one size to the next: give sizes smallest first, or one per
+    // run for each size's own
+    std::vector<int> sizes{1000, 10000, 100000};
+    double degree = 8;
+    double density = 0;
+    size_t queryCount = 200;
+    std::vector<std::string> searches{"dfs", "bfs", "hops", "uniform", "heap", "delta", "bidirectional", "astar"};
+    int labelCorrectingLimit = 2000;
+    int landmarkCount = 8;
+    unsigned threadCount = hardwareThreads();
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--nodes" && i + 1 < argc) {
+            sizes.clear();
+            for (auto &size : splitList(argv[++i])) {
+                sizes.push_back(std::max(2, std::stoi(size)));
+            }
+        } else if (arg == "--degree" && i + 1 < argc) {
+            degree = std::max(0.0, std::stod(argv[++i]));
+            density = 0;
+        } else if (arg == "--density" && i + 1 < argc) {
+            density = std::min(1.0, std::max(0.0, std::stod(argv[++i])));
+        } else if (arg == "--queries" && i + 1 < argc) {
+            queryCount = size_t(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--searches" && i + 1 < argc) {
+            searches = splitList(argv[++i]);
+        } else if (arg == "--label-correcting-limit" && i + 1 < argc) {
+            labelCorrectingLimit = std::stoi(argv[++i]);
+        } else if (arg == "--landmarks" && i + 1 < argc) {
+            landmarkCount = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = unsigned(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = unsigned(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+    for (auto &name : searches) {
+        if (name != "dfs" && name != "bfs" && name != "hops" && name != "uniform" && name != "heap" &&
+            name != "delta" && name != "bidirectional" && name != "astar") {
+            std::cerr << "Unknown search " << name << std::endl;
+            return 1;
+        }
+    }
+
+    Benchmark benchmark;
+    Benchmark::header(std::cout);
+    for (int nodeCount : sizes) {
+        uint64_t pairCount = density > 0 ? pairsForDensity(nodeCount, density) : pairsForDegree(nodeCount, degree);
+        Graph graph;
+        {
+            std::vector<Edge> edges;
+            benchmark.time("generate", [&]() {
+                edges = generateEdges(nodeCount, pairCount, seed + nodeCount, threadCount);
+            });
+            benchmark.time("build", [&]() { graph = Graph(nodeCount, edges); });
+        }
+        Graph reverse;
+        benchmark.time("reverse", [&]() { reverse = reversed(graph); });
+        Landmarks landmarks;
+        if (std::find(searches.begin(), searches.end(), "astar") != searches.end()) {
+            benchmark.time("landmarks", [&]() { landmarks = Landmarks(graph, reverse, landmarkCount, threadCount); });
+        }
+        SearchScratch scratch(graph);
+
+        std::mt19937 rng(seed + unsigned(nodeCount) + 1);
+        std::vector<std::pair<int, int>> pairs(queryCount);
+        for (auto &pair : pairs) {
+            pair.first = int(rng() % uint32_t(nodeCount));
+            pair.second = int(rng() % uint32_t(nodeCount));
+        }
+        for (auto &name : searches) {
+            if (name == "dfs" && nodeCount <= labelCorrectingLimit) {
+                benchmark.timeSearches<std::stack<int>>(name, pairs, graph, nullptr, nullptr, scratch, threadCount);
+            } else if (name == "bfs" && nodeCount <= labelCorrectingLimit) {
+                benchmark.timeSearches<std::queue<int>>(name, pairs, graph, nullptr, nullptr, scratch, threadCount);
+            } else if (name == "hops") {
+                benchmark.timeSearches<FewestHops>(name, pairs, graph, &reverse, nullptr, scratch, threadCount);
+            } else if (name == "uniform") {
+                benchmark.timeSearches<BucketQueue>(name, pairs, graph, nullptr, nullptr, scratch, threadCount);
+            } else if (name == "heap") {
+                benchmark.timeSearches<IndexedHeap<>>(name, pairs, graph, nullptr, nullptr, scratch, threadCount);
+            } else if (name == "delta") {
+                benchmark.timeSearches<DeltaStepping>(name, pairs, graph, nullptr, nullptr, scratch, threadCount);
+            } else if (name == "bidirectional") {
+                benchmark.timeSearches<Bidirectional>(name, pairs, graph, &reverse, nullptr, scratch, threadCount);
+            } else if (name == "astar") {
+                benchmark.timeSearches<LandmarkAStar>(name, pairs, graph, &reverse, &landmarks, scratch,
+                                                      threadCount);
+            }
+        }
+        benchmark.report(std::cout, nodeCount, graph.edgeCount());
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+#ifndef PROJECT4_DELTASTEPPING_H
+#define PROJECT4_DELTASTEPPING_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "parallel.h"
+#include "graph.h"
+
+// What a delta stepping run found: distance and parent of every node it reached, unreachable and -1 for the rest
+struct ShortestPathTree {
+    std::vector<int> distance;
+    std::vector<int> parent;
+    // Bucket insertions, nodes taken out of a bucket to relax, and distinct nodes whose bucket was finished
+    uint64_t queued = 0;
+    uint64_t relaxed = 0;
+    uint64_t settled = 0;
+    // Light or heavy edges looked at, whichever a pass was relaxing
+    uint64_t scanned = 0;
+};
+
+// A delta for graph when none is given: its mean edge weight, from a sample of up to a few thousand edges
+inline int defaultDelta(const Graph &graph) {
+    uint64_t edges = graph.edgeCount();
+    uint64_t samples = std::min<uint64_t>(edges, 4096);
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < samples; i++) {
+        total += uint64_t(graph.weight(i * edges / samples));
+    }
+    return samples == 0 ? 1 : std::max(1, int(total / samples));
+}
+
+// Rounds and heavy passes over fewer nodes than this are run on the calling thread rather than shared out
+const size_t deltaParallelNodes = 256;
+
+/*
+ * Delta stepping (Meyer and Sanders): bucket i holds the nodes with a tentative distance in [i delta, (i + 1) delta),
+ * and the lowest non empty bucket is emptied in rounds, every node in it relaxing its light edges (weight <= delta) on
+ * threadCount threads at once, from one WorkerPool for the whole search. A light edge can put a node back into the same
+ * bucket, hence the rounds. Once the bucket stays empty its nodes are final, and their heavy edges, which can only
+ * reach later buckets, are relaxed once in one more parallel pass. delta 1 makes it Dijkstra with a bucket per
+ * distance, a huge delta makes it Bellman-Ford; in between, each round has enough nodes to share out while few of them
+ * are relaxed more than once.
+ *
+ * Each node's distance and parent are one 64 bit atomic, lowered with compare and swap, so every parent is the node
+ * that last lowered the distance next to it. Stops after the bucket holding target (all buckets if target is -1).
+ * Weights can't be negative.
+ */
+inline ShortestPathTree deltaStepping(const Graph &graph, int source, int target, int delta, unsigned threadCount) {
+    int nodeCount = graph.nodeCount();
+    delta = std::max(delta, 1);
+    auto pack = [](int distance, int parent) { return uint64_t(uint32_t(distance)) << 32 | uint32_t(parent); };
+    auto distanceOf = [](uint64_t packed) { return int(packed >> 32); };
+    std::unique_ptr<std::atomic<uint64_t>[]> best(new std::atomic<uint64_t>[size_t(nodeCount)]);
+    for (int node = 0; node < nodeCount; node++) {
+        best[node].store(pack(unreachable, -1), std::memory_order_relaxed);
+    }
+    best[source].store(pack(0, -1), std::memory_order_relaxed);
+
+    ShortestPathTree tree;
+    std::vector<std::vector<int>> buckets(1, std::vector<int>{source});
+    // The last round (and bucket) a node was queued for relaxing in, so each is relaxed once per round
+    std::vector<uint64_t> lastRound(size_t(nodeCount), 0);
+    std::vector<size_t> lastBucket(size_t(nodeCount), SIZE_MAX);
+    uint64_t round = 0;
+    WorkerPool pool(threadCount);
+    unsigned workers = pool.size();
+    std::vector<std::vector<int>> lowered(workers);
+    // Edges each worker looked at, summed at the end
+    std::vector<uint64_t> scanned(workers, 0);
+    tree.queued = 1;
+
+    // Relaxes the light or heavy edges of nodes on every worker, then files the nodes they lowered into their buckets
+    auto relaxAll = [&](const std::vector<int> &nodes, bool light) {
+        pool.run([&](unsigned worker) {
+            std::vector<int> &mine = lowered[worker];
+            mine.clear();
+            uint64_t looked = 0;
+            for (size_t i = nodes.size() * worker / workers; i < nodes.size() * (worker + 1) / workers; i++) {
+                int current = nodes[i];
+                int through = distanceOf(best[current].load(std::memory_order_relaxed));
+                for (uint64_t edge = graph.firstEdge(current); edge < graph.lastEdge(current); edge++) {
+                    if ((graph.weight(edge) <= delta) != light) {
+                        continue;
+                    }
+                    looked++;
+                    int neigh = graph.target(edge);
+                    int distance = through + graph.weight(edge);
+                    uint64_t seen = best[neigh].load(std::memory_order_relaxed);
+                    while (distance < distanceOf(seen) &&
+                           !best[neigh].compare_exchange_weak(seen, pack(distance, current),
+                                                              std::memory_order_relaxed)) {
+                    }
+                    if (distance < distanceOf(seen)) {
+                        mine.push_back(neigh);
+                    }
+                }
+            }
+            scanned[worker] += looked;
+        }, nodes.size() >= deltaParallelNodes);
+        for (auto &mine : lowered) {
+            for (int node : mine) {
+                size_t bucket = size_t(distanceOf(best[node].load(std::memory_order_relaxed)) / delta);
+                if (bucket >= buckets.size()) {
+                    buckets.resize(bucket + 1);
+                }
+                buckets[bucket].push_back(node);
+                tree.queued++;
+            }
+        }
+    };
+
+    std::vector<int> frontier;
+    std::vector<int> finished;
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        finished.clear();
+        while (!buckets[bucket].empty()) {
+            round++;
+            frontier.clear();
+            for (int node : buckets[bucket]) {
+                // Nodes lowered into an earlier bucket since, or already in this round, are skipped
+                if (size_t(distanceOf(best[node].load(std::memory_order_relaxed)) / delta) == bucket &&
+                    lastRound[node] != round) {
+                    lastRound[node] = round;
+                    frontier.push_back(node);
+                    if (lastBucket[node] != bucket) {
+                        lastBucket[node] = bucket;
+                        finished.push_back(node);
+                    }
+                }
+            }
+            buckets[bucket].clear();
+            tree.relaxed += frontier.size();
+            relaxAll(frontier, true);
+        }
+        tree.settled += finished.size();
+        relaxAll(finished, false);
+        std::vector<int>().swap(buckets[bucket]);
+        if (target >= 0 && size_t(distanceOf(best[target].load(std::memory_order_relaxed)) / delta) <= bucket) {
+            break;
+        }
+    }
+
+    for (uint64_t count : scanned) {
+        tree.scanned += count;
+    }
+    tree.distance.resize(size_t(nodeCount));
+    tree.parent.resize(size_t(nodeCount));
+    for (int node = 0; node < nodeCount; node++) {
+        uint64_t packed = best[node].load(std::memory_order_relaxed);
+        tree.distance[node] = distanceOf(packed);
+        tree.parent[node] = int(uint32_t(packed));
+    }
+    return tree;
+}
+
+#endif //PROJECT4_DELTASTEPPING_H
@@ -1,12 +1,163 @@
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "parallel.h"
+#include "graph.h"
+#include "graphGenerator.h"
 
 using namespace std;
 
+// Digits of value onto the end of out, without the allocation of to_string
+inline void appendNumber(string &out, uint64_t value) {
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = char('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (length > 0) {
+        out += digits[--length];
+    }
+}
+
+// "u v w" lines for pairs, each an undirected edge the way Task2 reads an edge list
+inline void appendEdgeLines(string &out, const vector<Edge> &pairs) {
+    for (auto &pair : pairs) {
+        appendNumber(out, uint64_t(pair.from));
+        out += ' ';
+        appendNumber(out, uint64_t(pair.to));
+        out += ' ';
+        appendNumber(out, uint64_t(pair.weight));
+        out += '\n';
+    }
+}
+
+inline void writeOut(const string &text) {
+    fwrite(text.data(), 1, text.size(), stdout);
+}
+
+/*
+ * gengraph --sparse n [--degree d] [--seed s] [--threads t] [--matrix]
+ *
+ * A connected graph of n nodes with an average of d edges leaving each (8 by default), for sizes the matrix can't get
+ * to: the same random pairs and weights, and the same joining of whatever isn't connected to node 0, as the dense
+ * mode, but drawn in chunks with a generator per chunk (see graphGenerator.h) so it's the same graph for the same seed
+ * on any number of threads, and the benchmarks can make it too. Written as an edge list, "n m" then a line of
+ * "u v w" per pair, unless --matrix asks for the adjacency matrix Task2 also reads.
+ *
+ * The edge list never holds the edges: the chunks are drawn once on every thread just to join their pairs in a
+ * union-find, which is what says which pairs the graph still needs and so what m is, and drawn again to be written,
+ * each chunk's lines going out in one write in chunk order. That's O(n) memory whatever m is. The matrix has to go out
+ * a row at a time, so its edges are kept in CSR form, O(n + m), and only a block of rows is ever spelled out at once.
+ */
+int generateSparse(int argc, char *argv[]) {
+    int n = 0;
+    double degree = 8;
+    uint64_t seed = uint64_t(time(0));
+    unsigned threadCount = hardwareThreads();
+    bool matrix = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--degree" && i + 1 < argc) {
+            degree = max(0.0, stod(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = stoull(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = unsigned(max(1, stoi(argv[++i])));
+        } else if (arg == "--matrix") {
+            matrix = true;
+        } else if (n == 0) {
+            n = atoi(argv[i]);
+        } else {
+            cerr << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    if (n < 3) n = 3;
+    uint64_t pairCount = pairsForDegree(n, degree);
+    // Workers only run this many chunks ahead of the writer, which bounds what's waiting to be written
+    size_t window = size_t(threadCount) * 4;
+    static char outputBuffer[1 << 20];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    if (matrix) {
+        Graph graph(n, generateEdges(n, pairCount, seed, threadCount));
+        string line = to_string(n) + "\n";
+        writeOut(line);
+        // A row is about 2n characters, so a block of them is a few megabytes at most
+        size_t rowsPerBlock = max<size_t>(1, (size_t(1) << 22) / (size_t(n) * 2));
+        size_t blocks = (size_t(n) + rowsPerBlock - 1) / rowsPerBlock;
+        orderedParallelFor<string>(blocks, threadCount, window, [&](size_t block) {
+            string rows;
+            vector<int> row(size_t(n), 0);
+            for (size_t i = block * rowsPerBlock; i < min(size_t(n), (block + 1) * rowsPerBlock); i++) {
+                // A pair drawn twice keeps the weight it was given last, as the dense mode's overwrite does
+                for (uint64_t edge = graph.firstEdge(int(i)); edge < graph.lastEdge(int(i)); edge++) {
+                    row[graph.target(edge)] = graph.weight(edge);
+                }
+                for (int weight : row) {
+                    appendNumber(rows, uint64_t(weight));
+                    rows += ' ';
+                }
+                rows += '\n';
+                for (uint64_t edge = graph.firstEdge(int(i)); edge < graph.lastEdge(int(i)); edge++) {
+                    row[graph.target(edge)] = 0;
+                }
+            }
+            return rows;
+        }, [](size_t, const string &rows) {
+            writeOut(rows);
+        });
+        fflush(stdout);
+        return 0;
+    }
+
+    uint64_t chunks = chunkCount(pairCount);
+    DisjointSets sets(n);
+    orderedParallelFor<vector<Edge>>(chunks, threadCount, window, [&](size_t chunk) {
+        vector<Edge> pairs;
+        generateChunk(n, pairCount, seed, chunk, pairs);
+        return pairs;
+    }, [&sets](size_t, const vector<Edge> &pairs) {
+        for (auto &pair : pairs) {
+            sets.join(pair.from, pair.to);
+        }
+    });
+    vector<Edge> connecting = connectingPairs(n, sets, seed);
+
+    string lines;
+    appendNumber(lines, uint64_t(n));
+    lines += ' ';
+    appendNumber(lines, pairCount + connecting.size());
+    lines += '\n';
+    writeOut(lines);
+    orderedParallelFor<string>(chunks, threadCount, window, [&](size_t chunk) {
+        vector<Edge> pairs;
+        generateChunk(n, pairCount, seed, chunk, pairs);
+        string text;
+        text.reserve(pairs.size() * 16);
+        appendEdgeLines(text, pairs);
+        return text;
+    }, [](size_t, const string &text) {
+        writeOut(text);
+    });
+    lines.clear();
+    appendEdgeLines(lines, connecting);
+    writeOut(lines);
+    fflush(stdout);
+    return 0;
+}
+
 
 int main(int argc, char * argv[])
 {
+    // gengraph --sparse n ... streams a big sparse graph instead, see generateSparse
+    if (argc > 1 && string(argv[1]) == "--sparse")
+        return generateSparse(argc, argv);
     int n = atoi(argv[1]);
     if (n < 3) n = 3;
     int ** a = new int * [n];
@@ -0,0 +1,469 @@
+#ifndef PROJECT4_GRADEQUERY_H
+#define PROJECT4_GRADEQUERY_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdint>
+#include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "studentData.h"
+#include "studentIndex.h"
+#include "parallel.h"
+
+// The names subjects go by in commands ("maths", "total"), -1 if it isn't one
+inline int subjectFromCommandName(const std::string &name) {
+    static const char *const commandNames[5]{"biology", "maths", "chemistry", "physics", "total"};
+    for (int i = 0; i < 5; i++) {
+        if (name == commandNames[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Cumulative histogram of one column: atLeast[g - minGrade] is how many students have a grade of g or higher. Any
+ * "how many above x" question is then a single array read instead of a binary search over a sorted index.
+ *
+ * withZero stretches the range down (or up) to 0 even when nobody has that grade, which is what a student who has just
+ * been added starts with, so live updates can slot them in instead of rebuilding.
+ */
+class GradeHistogram {
+public:
+    GradeHistogram() = default;
+
+    explicit GradeHistogram(const std::vector<int> &column, bool withZero = false) {
+        if (column.empty()) {
+            return;
+        }
+        auto range = std::minmax_element(column.begin(), column.end());
+        minGrade = withZero ? std::min(*range.first, 0) : *range.first;
+        maxGrade = withZero ? std::max(*range.second, 0) : *range.second;
+        atLeast.assign(size_t(maxGrade - minGrade) + 2, 0);
+        for (int grade : column) {
+            atLeast[grade - minGrade]++;
+        }
+        for (size_t i = atLeast.size() - 1; i-- > 0;) {
+            atLeast[i] += atLeast[i + 1];
+        }
+    }
+
+    inline StudentId countAtLeast(int value) const {
+        if (atLeast.empty() || value > maxGrade) {
+            return 0;
+        }
+        return atLeast[value <= minGrade ? 0 : value - minGrade];
+    }
+
+    inline StudentId countAbove(int value) const {
+        return value == INT32_MAX ? 0 : countAtLeast(value + 1);
+    }
+
+    inline int lowest() const { return minGrade; }
+
+    inline int highest() const { return maxGrade; }
+
+    // The lowest grade someone actually has, above lowest() when the range was stretched to 0
+    int lowestPresent() const {
+        int grade = minGrade;
+        while (grade < maxGrade && atLeast[grade + 1 - minGrade] == atLeast[0]) {
+            grade++;
+        }
+        return grade;
+    }
+
+    inline bool covers(int grade) const {
+        return !atLeast.empty() && grade >= minGrade && grade <= maxGrade;
+    }
+
+    /*
+     * The histogram doubles as the group boundaries of the sorted index it was built next to: students with grade g
+     * sit at [atLeast[g + 1], atLeast[g]). These keep both in step as students come in and change grade, with positions
+     * being the inverse of sorted (where each id currently is).
+     *
+     * A new student goes on the end of sorted, which is where the lowest grade lives.
+     */
+    void appendLowest(StudentId id, std::vector<StudentId> &sorted, std::vector<StudentId> &positions) {
+        if (positions.size() <= id) {
+            positions.resize(id + 1);
+        }
+        positions[id] = StudentId(sorted.size());
+        sorted.push_back(id);
+        atLeast[0]++;
+    }
+
+    /*
+     * Moves id from one grade to another (both must be covered) by walking it across the groups in between. Crossing a
+     * group is one swap with the element on that group's edge and moving the edge by one, so this is O(|from - to|)
+     * and the index never needs resorting.
+     */
+    void regrade(StudentId id, int from, int to, std::vector<StudentId> &sorted, std::vector<StudentId> &positions) {
+        auto swapPositions = [&](StudentId i, StudentId j) {
+            std::swap(sorted[i], sorted[j]);
+            positions[sorted[i]] = i;
+            positions[sorted[j]] = j;
+        };
+        for (int grade = from; grade > to; grade--) {
+            // Become the last of this group, then the group shrinks and id is the first of the one below
+            swapPositions(positions[id], atLeast[grade - minGrade] - 1);
+            atLeast[grade - minGrade]--;
+        }
+        for (int grade = from; grade < to; grade++) {
+            // Become the first of this group, then the group above grows to take id in as its last
+            swapPositions(positions[id], atLeast[grade + 1 - minGrade]);
+            atLeast[grade + 1 - minGrade]++;
+        }
+    }
+
+    inline size_t memoryBytes() const { return atLeast.capacity() * sizeof(StudentId); }
+
+private:
+    int minGrade = 0;
+    int maxGrade = 0;
+    // One extra zero on the end for maxGrade + 1
+    std::vector<StudentId> atLeast;
+};
+
+/*
+ * Range encoded bitmaps for one column. The grades are cut into at most maxBuckets buckets and bitmaps[k] has a bit set
+ * for every student whose grade is at least the start of bucket k. A threshold that lands on a bucket start is a copy of
+ * one bitmap; otherwise the next bucket's bitmap is topped up with the few students between the threshold and that
+ * bucket, who sit together in the sorted index. Combining subjects is then just AND-ing words.
+ */
+class GradeBitmapIndex {
+public:
+    static constexpr int maxBuckets = 16;
+
+    GradeBitmapIndex() = default;
+
+    // The sorted index is only needed (and only built) once a threshold falls inside a bucket
+    GradeBitmapIndex(const std::vector<int> &column, const LazyIndexes &indexes, int subject,
+                     const GradeHistogram &histogram)
+            : indexes(&indexes), subject(subject), histogram(&histogram), studentCount(StudentId(column.size())),
+              wordCount((column.size() + 63) / 64) {
+        minGrade = histogram.lowest();
+        int spread = histogram.highest() - minGrade + 1;
+        bucketWidth = (spread + maxBuckets - 1) / maxBuckets;
+        int bucketCount = (spread + bucketWidth - 1) / bucketWidth;
+        bitmaps.assign(bucketCount, std::vector<uint64_t>(wordCount, 0));
+        if (column.empty()) {
+            return;
+        }
+        // Each student goes in their own bucket first, then every bucket takes in all the ones above it
+        for (StudentId id = 0; id < studentCount; id++) {
+            bitmaps[(column[id] - minGrade) / bucketWidth][id / 64] |= uint64_t(1) << (id % 64);
+        }
+        for (int bucket = bucketCount - 1; bucket-- > 0;) {
+            orInto(bitmaps[bucket], bitmaps[bucket + 1]);
+        }
+    }
+
+    // out becomes the bitmap of students with a grade >= value
+    void atLeast(int value, std::vector<uint64_t> &out) const {
+        out.assign(wordCount, 0);
+        if (histogram->countAtLeast(value) == 0) {
+            return;
+        }
+        if (value <= minGrade) {
+            out = bitmaps[0];
+            return;
+        }
+        int bucket = (value - minGrade + bucketWidth - 1) / bucketWidth;
+        int bucketStart = minGrade + bucket * bucketWidth;
+        if (bucket < int(bitmaps.size())) {
+            out = bitmaps[bucket];
+        }
+        // Students in [value, bucketStart) are the ones just before bucketStart in the sorted index
+        StudentId from = histogram->countAtLeast(bucketStart);
+        StudentId to = histogram->countAtLeast(value);
+        if (from == to) {
+            return;
+        }
+        const std::vector<StudentId> &sorted = indexes->get(subject);
+        for (StudentId i = from; i < to; i++) {
+            StudentId id = sorted[i];
+            out[id / 64] |= uint64_t(1) << (id % 64);
+        }
+    }
+
+    // For new students and changed grades, the histogram (and sorted index) must already cover grade
+    void addStudent(StudentId id, int grade) {
+        while (wordCount <= id / 64) {
+            for (auto &bitmap : bitmaps) {
+                bitmap.push_back(0);
+            }
+            wordCount++;
+        }
+        studentCount = std::max(studentCount, id + 1);
+        setBuckets(id, minGrade - 1, grade);
+    }
+
+    void regrade(StudentId id, int from, int to) {
+        setBuckets(id, from, to);
+    }
+
+    inline size_t words() const { return wordCount; }
+
+    inline StudentId students() const { return studentCount; }
+
+    size_t memoryBytes() const {
+        size_t bytes = 0;
+        for (auto &bitmap : bitmaps) {
+            bytes += bitmap.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    // Written as plain word loops so -O3 vectorises them
+    static void orInto(std::vector<uint64_t> &into, const std::vector<uint64_t> &from) {
+        for (size_t i = 0; i < into.size(); i++) {
+            into[i] |= from[i];
+        }
+    }
+
+    static void andInto(std::vector<uint64_t> &into, const std::vector<uint64_t> &from, bool negate) {
+        uint64_t flip = negate ? ~uint64_t(0) : 0;
+        for (size_t i = 0; i < into.size(); i++) {
+            into[i] &= from[i] ^ flip;
+        }
+    }
+
+    static StudentId popcount(const std::vector<uint64_t> &bitmap) {
+        uint64_t count = 0;
+        for (uint64_t word : bitmap) {
+            count += uint64_t(__builtin_popcountll(word));
+        }
+        return StudentId(count);
+    }
+
+private:
+    // Bucket k holds id exactly when grade >= its start, so only the buckets starting in (from, to] or (to, from] flip
+    void setBuckets(StudentId id, int from, int to) {
+        uint64_t bit = uint64_t(1) << (id % 64);
+        for (size_t bucket = 0; bucket < bitmaps.size(); bucket++) {
+            int bucketStart = minGrade + int(bucket) * bucketWidth;
+            if (bucketStart <= to && bucketStart > from) {
+                bitmaps[bucket][id / 64] |= bit;
+            } else if (bucketStart <= from && bucketStart > to) {
+                bitmaps[bucket][id / 64] &= ~bit;
+            }
+        }
+    }
+
+    const LazyIndexes *indexes = nullptr;
+    int subject = 0;
+    const GradeHistogram *histogram = nullptr;
+    StudentId studentCount = 0;
+    size_t wordCount = 0;
+    int minGrade = 0;
+    int bucketWidth = 1;
+    std::vector<std::vector<uint64_t>> bitmaps;
+};
+
+/*
+ * One comparison out of a compound query such as "biology>80 and maths>=70". Every comparison is rewritten in terms
+ * of "grade >= threshold", possibly negated, because that's what the bitmaps answer.
+ */
+struct GradeCondition {
+    int subject;
+    int threshold;
+    bool negate;
+};
+
+/*
+ * Whether line is meant as a compound query: a subject name straight followed (spaces aside) by a comparison. Only
+ * those go to parseGradeQuery, so a command or a name that just happens to have a < > or = in it still runs as one.
+ */
+inline bool isGradeQuery(const std::string &line) {
+    size_t pos = 0;
+    while (pos < line.size() && std::isspace((unsigned char) line[pos])) pos++;
+    size_t start = pos;
+    while (pos < line.size() && std::isalpha((unsigned char) line[pos])) pos++;
+    std::string word = line.substr(start, pos - start);
+    for (auto &c : word) c = char(std::tolower((unsigned char) c));
+    while (pos < line.size() && std::isspace((unsigned char) line[pos])) pos++;
+    return subjectFromCommandName(word) >= 0 && pos < line.size() &&
+           (line[pos] == '<' || line[pos] == '>' || line[pos] == '=' || line[pos] == '!');
+}
+
+/*
+ * Parses "subject op value [and subject op value]..." where op is one of > >= < <= = ==. Throws
+ * std::invalid_argument describing the first thing it didn't understand.
+ */
+inline std::vector<GradeCondition> parseGradeQuery(const std::string &query) {
+    std::vector<GradeCondition> conditions;
+    size_t pos = 0;
+    auto skipSpaces = [&]() {
+        while (pos < query.size() && std::isspace((unsigned char) query[pos])) pos++;
+    };
+    auto readWord = [&]() {
+        skipSpaces();
+        size_t start = pos;
+        while (pos < query.size() && std::isalpha((unsigned char) query[pos])) pos++;
+        std::string word = query.substr(start, pos - start);
+        for (auto &c : word) c = char(std::tolower((unsigned char) c));
+        return word;
+    };
+
+    while (true) {
+        std::string subjectName = readWord();
+        int subject = subjectFromCommandName(subjectName);
+        if (subject < 0) {
+            throw std::invalid_argument("unknown subject '" + subjectName + "'");
+        }
+        skipSpaces();
+        size_t opStart = pos;
+        while (pos < query.size() && (query[pos] == '<' || query[pos] == '>' || query[pos] == '=' ||
+                                      query[pos] == '!')) {
+            pos++;
+        }
+        std::string op = query.substr(opStart, pos - opStart);
+        skipSpaces();
+        size_t parsed = 0;
+        int value;
+        try {
+            value = std::stoi(query.substr(pos), &parsed);
+        } catch (std::exception &) {
+            throw std::invalid_argument("expected a grade after " + subjectName + op);
+        }
+        pos += parsed;
+        if (value == INT32_MAX && op != "<" && op != ">=") {
+            throw std::invalid_argument("grade is too large");
+        }
+
+        if (op == ">=") {
+            conditions.push_back({subject, value, false});
+        } else if (op == ">") {
+            conditions.push_back({subject, value + 1, false});
+        } else if (op == "<") {
+            conditions.push_back({subject, value, true});
+        } else if (op == "<=") {
+            conditions.push_back({subject, value + 1, true});
+        } else if (op == "=" || op == "==") {
+            conditions.push_back({subject, value, false});
+            conditions.push_back({subject, value + 1, true});
+        } else {
+            throw std::invalid_argument("unknown comparison '" + op + "'");
+        }
+
+        std::string joiner = readWord();
+        skipSpaces();
+        if (joiner.empty() && pos == query.size()) {
+            return conditions;
+        }
+        if (joiner != "and") {
+            throw std::invalid_argument(joiner.empty() ? "unexpected '" + query.substr(pos) + "'"
+                                                       : "expected 'and' but found '" + joiner + "'");
+        }
+    }
+}
+
+/*
+ * Everything needed to answer counting queries without touching the sorted indexes again: a histogram and a set of
+ * bitmaps per subject. Like the sorted indexes, each subject's are only built the first time a query needs them, and
+ * that's safe to race on. The bitmaps keep pointers to the sorted indexes and histograms, so those must not move.
+ */
+class GradeQueryIndex {
+public:
+    GradeQueryIndex(const StudentStore &studentData, const LazyIndexes &sortedIndexes)
+            : studentData(studentData), sortedIndexes(sortedIndexes) {}
+
+    GradeQueryIndex(const GradeQueryIndex &) = delete;
+
+    GradeQueryIndex &operator=(const GradeQueryIndex &) = delete;
+
+    // Builds whatever hasn't been built yet, on up to threadCount threads
+    void buildAll(unsigned threadCount) const {
+        runOnThreads(std::min(threadCount, 5u), [&](unsigned first) {
+            for (unsigned subject = first; subject < 5; subject += std::min(threadCount, 5u)) {
+                bitmap(int(subject));
+            }
+        });
+    }
+
+    // Starts subject over from the store with 0 in range (see GradeHistogram); for someone holding the store exclusively
+    void rebuild(int subject) {
+        histogram(subject) = GradeHistogram(studentData.column(subject), true);
+        bitmap(subject) = GradeBitmapIndex(studentData.column(subject), sortedIndexes, subject, histograms[subject]);
+    }
+
+    const GradeHistogram &histogram(int subject) const {
+        std::call_once(histogramOnce[subject], [this, subject]() {
+            auto start = std::chrono::steady_clock::now();
+            histograms[subject] = GradeHistogram(studentData.column(subject));
+            buildNanoseconds[subject] += elapsedNanoseconds(start);
+            histogramBuilt[subject] = true;
+        });
+        return histograms[subject];
+    }
+
+    const GradeBitmapIndex &bitmap(int subject) const {
+        std::call_once(bitmapOnce[subject], [this, subject]() {
+            const GradeHistogram &subjectHistogram = histogram(subject);
+            auto start = std::chrono::steady_clock::now();
+            bitmaps[subject] = GradeBitmapIndex(studentData.column(subject), sortedIndexes, subject,
+                                                subjectHistogram);
+            buildNanoseconds[subject] += elapsedNanoseconds(start);
+            bitmapBuilt[subject] = true;
+        });
+        return bitmaps[subject];
+    }
+
+    // How long building subject's histogram and bitmaps has taken so far, 0 if neither has been
+    inline uint64_t buildTime(int subject) const { return buildNanoseconds[subject]; }
+
+    // Bytes held by whatever has been built
+    size_t memoryBytes() const {
+        size_t bytes = 0;
+        for (int subject = 0; subject < 5; subject++) {
+            bytes += histogramBuilt[subject] ? histograms[subject].memoryBytes() : 0;
+            bytes += bitmapBuilt[subject] ? bitmaps[subject].memoryBytes() : 0;
+        }
+        return bytes;
+    }
+
+    // For keeping them up to date in place
+    inline GradeHistogram &histogram(int subject) {
+        return const_cast<GradeHistogram &>(static_cast<const GradeQueryIndex &>(*this).histogram(subject));
+    }
+
+    inline GradeBitmapIndex &bitmap(int subject) {
+        return const_cast<GradeBitmapIndex &>(static_cast<const GradeQueryIndex &>(*this).bitmap(subject));
+    }
+
+    inline StudentId countAbove(int subject, int value) const {
+        return histogram(subject).countAbove(value);
+    }
+
+    StudentId countMatching(const std::vector<GradeCondition> &conditions) const {
+        StudentId studentCount = studentData.size();
+        std::vector<uint64_t> result((size_t(studentCount) + 63) / 64, ~uint64_t(0));
+        std::vector<uint64_t> condition;
+        for (auto &c : conditions) {
+            bitmap(c.subject).atLeast(c.threshold, condition);
+            GradeBitmapIndex::andInto(result, condition, c.negate);
+        }
+        // Negated conditions set the bits past the last student, clear them before counting
+        if (studentCount % 64 != 0) {
+            result.back() &= (uint64_t(1) << (studentCount % 64)) - 1;
+        }
+        return GradeBitmapIndex::popcount(result);
+    }
+
+private:
+    const StudentStore &studentData;
+    const LazyIndexes &sortedIndexes;
+    mutable std::array<GradeHistogram, 5> histograms;
+    mutable std::array<GradeBitmapIndex, 5> bitmaps;
+    mutable std::array<std::once_flag, 5> histogramOnce;
+    mutable std::array<std::once_flag, 5> bitmapOnce;
+    mutable std::array<std::atomic<bool>, 5> histogramBuilt{};
+    mutable std::array<std::atomic<bool>, 5> bitmapBuilt{};
+    mutable std::array<std::atomic<uint64_t>, 5> buildNanoseconds{};
+};
+
+#endif //PROJECT4_GRADEQUERY_H
@@ -0,0 +1,103 @@
+#ifndef PROJECT4_GRADESTATS_H
+#define PROJECT4_GRADESTATS_H
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "studentData.h"
+
+const char *const subjectNames[5]{"Biology", "Mathematics", "Chemistry", "Physics", "Total"};
+
+struct ColumnSummary {
+    StudentId count = 0;
+    int minimum = 0;
+    int maximum = 0;
+    double mean = 0;
+    // Population standard deviation, everyone is in the table so it isn't a sample
+    double stddev = 0;
+};
+
+/*
+ * Count, sum, sum of squares, minimum and maximum of a column in a single pass. With SSE2 four grades are done per
+ * instruction: they're widened to doubles two at a time for the sums (exact well past any real total of grades, and
+ * squares can't overflow) and min/max are kept per lane with compare and mask, since SSE2 has no 32 bit min/max.
+ */
+inline ColumnSummary summarise(const std::vector<int> &column) {
+    ColumnSummary summary;
+    summary.count = StudentId(column.size());
+    if (column.empty()) {
+        return summary;
+    }
+    const int *grades = column.data();
+    size_t count = column.size();
+    size_t i = 0;
+    double sum = 0;
+    double squares = 0;
+    int minimum = grades[0];
+    int maximum = grades[0];
+#ifdef __SSE2__
+    __m128d sums[2]{_mm_setzero_pd(), _mm_setzero_pd()};
+    __m128d squareSums[2]{_mm_setzero_pd(), _mm_setzero_pd()};
+    __m128i minimums = _mm_set1_epi32(minimum);
+    __m128i maximums = _mm_set1_epi32(maximum);
+    for (; i + 4 <= count; i += 4) {
+        __m128i four = _mm_loadu_si128(reinterpret_cast<const __m128i *>(grades + i));
+        __m128d low = _mm_cvtepi32_pd(four);
+        __m128d high = _mm_cvtepi32_pd(_mm_shuffle_epi32(four, _MM_SHUFFLE(1, 0, 3, 2)));
+        sums[0] = _mm_add_pd(sums[0], low);
+        sums[1] = _mm_add_pd(sums[1], high);
+        squareSums[0] = _mm_add_pd(squareSums[0], _mm_mul_pd(low, low));
+        squareSums[1] = _mm_add_pd(squareSums[1], _mm_mul_pd(high, high));
+        __m128i lower = _mm_cmplt_epi32(four, minimums);
+        minimums = _mm_or_si128(_mm_and_si128(lower, four), _mm_andnot_si128(lower, minimums));
+        __m128i higher = _mm_cmpgt_epi32(four, maximums);
+        maximums = _mm_or_si128(_mm_and_si128(higher, four), _mm_andnot_si128(higher, maximums));
+    }
+    double lanes[4];
+    _mm_storeu_pd(lanes, _mm_add_pd(sums[0], sums[1]));
+    sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes + 2, _mm_add_pd(squareSums[0], squareSums[1]));
+    squares = lanes[2] + lanes[3];
+    int minimumLanes[4];
+    int maximumLanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(minimumLanes), minimums);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(maximumLanes), maximums);
+    minimum = *std::min_element(minimumLanes, minimumLanes + 4);
+    maximum = *std::max_element(maximumLanes, maximumLanes + 4);
+#endif
+    for (; i < count; i++) {
+        double grade = grades[i];
+        sum += grade;
+        squares += grade * grade;
+        minimum = std::min(minimum, grades[i]);
+        maximum = std::max(maximum, grades[i]);
+    }
+    summary.minimum = minimum;
+    summary.maximum = maximum;
+    summary.mean = sum / double(count);
+    summary.stddev = std::sqrt(std::max(0.0, squares / double(count) - summary.mean * summary.mean));
+    return summary;
+}
+
+/*
+ * The p-th percentile (0 to 100) of a column, read straight out of its sorted index (highest grade first) and
+ * interpolated between the two nearest ranks, so percentile 50 is the usual median.
+ */
+inline double percentile(const std::vector<int> &column, const std::vector<StudentId> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    double rank = std::min(std::max(p, 0.0), 100.0) / 100 * double(sorted.size() - 1);
+    size_t below = size_t(rank);
+    size_t above = std::min(below + 1, sorted.size() - 1);
+    // Rank r from the bottom is position size - 1 - r from the top
+    double low = column[sorted[sorted.size() - 1 - below]];
+    double high = column[sorted[sorted.size() - 1 - above]];
+    return low + (rank - double(below)) * (high - low);
+}
+
+#endif //PROJECT4_GRADESTATS_H
@@ -0,0 +1,329 @@
+#ifndef PROJECT4_GRAPH_H
+#define PROJECT4_GRAPH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "mappedFile.h"
+#include "parallel.h"
+
+// The distance to a node there's no path to
+const int unreachable = std::numeric_limits<int>::max();
+
+struct Edge {
+    int from;
+    int to;
+    int weight;
+};
+
+/*
+ * Weighted directed graph in compressed sparse row form: the edges leaving node are
+ * [firstEdge(node), lastEdge(node)), and each edge is a target and a weight in two arrays that are walked front to
+ * back. Memory and the time to visit a node's neighbours are both proportional to the edges it actually has, rather
+ * than to the number of nodes as with an adjacency matrix.
+ *
+ * The arrays are either the graph's own or inside a mapped binary graph file it holds on to (see graphFile.h), which is
+ * why it's reached through pointers. A mapped graph keeps its weights as single bytes. Moving a graph keeps the
+ * pointers valid, copying one wouldn't, so it can only be moved.
+ */
+class Graph {
+public:
+    Graph() = default;
+
+    // Every non zero entry matrix[i][j] is an edge from i to j
+    explicit Graph(const std::vector<std::vector<int>> &matrix) {
+        offsets.reserve(matrix.size() + 1);
+        offsets.push_back(0);
+        for (auto &row : matrix) {
+            for (size_t j = 0; j < row.size(); j++) {
+                if (row[j] != 0) {
+                    targets.push_back(uint32_t(j));
+                    weights.push_back(row[j]);
+                }
+            }
+            offsets.push_back(targets.size());
+        }
+        pointAtOwnArrays();
+    }
+
+    // The edges can be in any order; those leaving the same node keep the order they were given in
+    Graph(int nodeCount, const std::vector<Edge> &edges) {
+        offsets.assign(size_t(nodeCount) + 1, 0);
+        for (auto &edge : edges) {
+            offsets[edge.from + 1]++;
+        }
+        for (int node = 0; node < nodeCount; node++) {
+            offsets[node + 1] += offsets[node];
+        }
+        targets.resize(edges.size());
+        weights.resize(edges.size());
+        std::vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+        for (auto &edge : edges) {
+            uint64_t slot = next[edge.from]++;
+            targets[slot] = uint32_t(edge.to);
+            weights[slot] = edge.weight;
+        }
+        pointAtOwnArrays();
+    }
+
+    // Takes over arrays that are already in CSR form, offsets has nodeCount + 1 entries
+    Graph(std::vector<uint64_t> &&offsets, std::vector<uint32_t> &&targets, std::vector<int> &&weights)
+            : offsets(std::move(offsets)), targets(std::move(targets)), weights(std::move(weights)) {
+        pointAtOwnArrays();
+    }
+
+    // Reads the arrays straight out of file, which the graph keeps mapped for as long as it lives
+    Graph(MappedFile &&file, int nodeCount, uint64_t edgeCount, const uint64_t *offsets, const uint32_t *targets,
+          const uint8_t *weights)
+            : mapping(std::move(file)), nodes(nodeCount), edges(edgeCount), offsetData(offsets),
+              targetData(targets), byteWeights(weights) {}
+
+    Graph(const Graph &) = delete;
+
+    Graph &operator=(const Graph &) = delete;
+
+    Graph(Graph &&) = default;
+
+    Graph &operator=(Graph &&) = default;
+
+    inline int nodeCount() const { return nodes; }
+
+    inline uint64_t edgeCount() const { return edges; }
+
+    inline uint64_t firstEdge(int node) const { return offsetData[node]; }
+
+    inline uint64_t lastEdge(int node) const { return offsetData[node + 1]; }
+
+    inline int target(uint64_t edge) const { return int(targetData[edge]); }
+
+    // A graph is either all bytes or all ints, so this branch always goes the same way
+    inline int weight(uint64_t edge) const { return byteWeights ? byteWeights[edge] : intWeights[edge]; }
+
+    inline bool isMapped() const { return mapping.size() > 0; }
+
+    // No edge weighs more than this. A mapped graph's weights are bytes, which is bound enough without reading them
+    inline int weightBound() const { return byteWeights ? UINT8_MAX : maxWeight; }
+
+private:
+    void pointAtOwnArrays() {
+        nodes = offsets.empty() ? 0 : int(offsets.size() - 1);
+        edges = targets.size();
+        offsetData = offsets.data();
+        targetData = targets.data();
+        intWeights = weights.data();
+        maxWeight = weights.empty() ? 0 : *std::max_element(weights.begin(), weights.end());
+    }
+
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> targets;
+    std::vector<int> weights;
+    MappedFile mapping;
+
+    int nodes = 0;
+    uint64_t edges = 0;
+    const uint64_t *offsetData = nullptr;
+    const uint32_t *targetData = nullptr;
+    const int *intWeights = nullptr;
+    const uint8_t *byteWeights = nullptr;
+    int maxWeight = 0;
+};
+
+// The same graph with every edge turned around, for searching backwards from a target
+inline Graph reversed(const Graph &graph) {
+    int nodeCount = graph.nodeCount();
+    std::vector<uint64_t> offsets(size_t(nodeCount) + 1, 0);
+    for (uint64_t edge = 0; edge < graph.edgeCount(); edge++) {
+        offsets[graph.target(edge) + 1]++;
+    }
+    for (int node = 0; node < nodeCount; node++) {
+        offsets[node + 1] += offsets[node];
+    }
+    std::vector<uint32_t> targets(graph.edgeCount());
+    std::vector<int> weights(graph.edgeCount());
+    std::vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+    for (int node = 0; node < nodeCount; node++) {
+        for (uint64_t edge = graph.firstEdge(node); edge < graph.lastEdge(node); edge++) {
+            uint64_t slot = next[graph.target(edge)]++;
+            targets[slot] = uint32_t(node);
+            weights[slot] = graph.weight(edge);
+        }
+    }
+    return Graph(std::move(offsets), std::move(targets), std::move(weights));
+}
+
+/*
+ * Reads a graph in either text format:
+ *  - an adjacency matrix, as gengraph writes: the node count n, then n rows of n weights where 0 means no edge
+ *  - an edge list: "n m" on the first line, then m lines of "u v w", each an undirected edge of weight w
+ * They're told apart by how many numbers are on the first line. Matrix rows are read one at a time and only their
+ * non zero entries are kept, so the whole matrix is never in memory. Throws std::runtime_error if the file can't be
+ * read.
+ *
+ * This is the stream based reader, loadGraph below does the same from a mapping on several threads.
+ */
+inline Graph loadGraphStream(const std::string &fileLocation) {
+    std::ifstream ifs(fileLocation);
+    std::string firstLine;
+    if (!ifs || !std::getline(ifs, firstLine)) {
+        throw std::runtime_error("Could not read " + fileLocation);
+    }
+    std::istringstream header(firstLine);
+    int nodeCount = 0;
+    long long edgeLines = 0;
+    header >> nodeCount;
+    std::vector<Edge> edges;
+    if (header >> edgeLines) {
+        edges.reserve(size_t(edgeLines) * 2);
+        Edge edge{};
+        for (long long i = 0; i < edgeLines && ifs >> edge.from >> edge.to >> edge.weight; i++) {
+            if (edge.from < 0 || edge.from >= nodeCount || edge.to < 0 || edge.to >= nodeCount) {
+                throw std::runtime_error("Edge " + std::to_string(i) + " of " + fileLocation + " is out of range");
+            }
+            edges.push_back(edge);
+            edges.push_back({edge.to, edge.from, edge.weight});
+        }
+    } else {
+        int weight;
+        for (int i = 0; i < nodeCount; i++) {
+            for (int j = 0; j < nodeCount && ifs >> weight; j++) {
+                if (weight != 0) {
+                    edges.push_back({i, j, weight});
+                }
+            }
+        }
+    }
+    return Graph(nodeCount, edges);
+}
+
+// Where the line starting at pos ends (at its newline, or end)
+inline const char *lineEndFrom(const char *pos, const char *end) {
+    const void *newline = std::memchr(pos, '\n', size_t(end - pos));
+    return newline ? static_cast<const char *>(newline) : end;
+}
+
+// What one thread parsed out of its chunk of matrix rows: how many edges each row has and the edges themselves
+struct MatrixRows {
+    std::vector<uint32_t> edgesPerRow;
+    std::vector<uint32_t> targets;
+    std::vector<int> weights;
+    bool malformed = false;
+};
+
+/*
+ * Parses a mapped graph file (either format, see loadGraphStream) on threadCount threads. Everything after the first
+ * line is cut into chunks at line boundaries and every thread scans its own with scanInt, so nothing goes through a
+ * stream. For a matrix each thread keeps only the non zero entries of its rows; the chunks come back in file order,
+ * so a row's number is just how many rows came before it, and the finished CSR arrays are copied together in
+ * parallel. Every matrix row has to be on its own line, which is how gengraph writes them.
+ *
+ * Throws std::runtime_error if the file doesn't have the shape its first line promises.
+ */
+inline Graph loadGraph(const MappedFile &file, unsigned threadCount) {
+    const char *headerEnd = lineEndFrom(file.begin(), file.end());
+    int nodeCount = 0;
+    int edgeLines = 0;
+    const char *pos = scanInt(file.begin(), headerEnd, nodeCount);
+    if (!pos || nodeCount < 0) {
+        throw std::runtime_error("A graph file has to start with the number of nodes");
+    }
+    bool edgeList = scanInt(pos, headerEnd, edgeLines) != nullptr;
+    const char *body = std::min(headerEnd + 1, file.end());
+    std::vector<const char *> bounds = splitAtLines(body, file.end(), std::max(threadCount, 1u));
+    unsigned chunkCount = unsigned(bounds.size() - 1);
+
+    if (edgeList) {
+        std::vector<std::vector<Edge>> chunkEdges(chunkCount);
+        std::vector<char> malformed(chunkCount, 0);
+        runOnThreads(chunkCount, [&](unsigned chunk) {
+            const char *at = bounds[chunk];
+            Edge edge{};
+            while ((at = skipBlanks(at, bounds[chunk + 1])) < bounds[chunk + 1]) {
+                const char *lineEnd = lineEndFrom(at, bounds[chunk + 1]);
+                if (!(at = scanInt(at, lineEnd, edge.from)) || !(at = scanInt(at, lineEnd, edge.to)) ||
+                    !(at = scanInt(at, lineEnd, edge.weight)) || edge.from < 0 || edge.from >= nodeCount ||
+                    edge.to < 0 || edge.to >= nodeCount) {
+                    malformed[chunk] = 1;
+                    return;
+                }
+                chunkEdges[chunk].push_back(edge);
+                chunkEdges[chunk].push_back({edge.to, edge.from, edge.weight});
+                at = lineEnd;
+            }
+        });
+        std::vector<Edge> edges;
+        for (unsigned chunk = 0; chunk < chunkCount; chunk++) {
+            if (malformed[chunk]) {
+                throw std::runtime_error("An edge line isn't three numbers within the node count");
+            }
+            edges.insert(edges.end(), chunkEdges[chunk].begin(), chunkEdges[chunk].end());
+            std::vector<Edge>().swap(chunkEdges[chunk]);
+        }
+        if (edges.size() != size_t(edgeLines) * 2) {
+            throw std::runtime_error("The edge count on the first line doesn't match the edges in the file");
+        }
+        return Graph(nodeCount, edges);
+    }
+
+    std::vector<MatrixRows> chunkRows(chunkCount);
+    runOnThreads(chunkCount, [&](unsigned chunk) {
+        MatrixRows &rows = chunkRows[chunk];
+        const char *at = bounds[chunk];
+        int weight;
+        while ((at = skipBlanks(at, bounds[chunk + 1])) < bounds[chunk + 1]) {
+            const char *lineEnd = lineEndFrom(at, bounds[chunk + 1]);
+            uint32_t edges = 0;
+            for (int column = 0; column < nodeCount; column++) {
+                if (!(at = scanInt(at, lineEnd, weight))) {
+                    rows.malformed = true;
+                    return;
+                }
+                if (weight != 0) {
+                    rows.targets.push_back(uint32_t(column));
+                    rows.weights.push_back(weight);
+                    edges++;
+                }
+            }
+            rows.edgesPerRow.push_back(edges);
+            at = lineEnd;
+        }
+    });
+
+    std::vector<uint64_t> offsets{0};
+    offsets.reserve(size_t(nodeCount) + 1);
+    std::vector<uint64_t> chunkStarts;
+    for (auto &rows : chunkRows) {
+        if (rows.malformed) {
+            throw std::runtime_error("A matrix row has fewer numbers than there are nodes");
+        }
+        chunkStarts.push_back(offsets.back());
+        for (uint32_t edges : rows.edgesPerRow) {
+            offsets.push_back(offsets.back() + edges);
+        }
+    }
+    if (offsets.size() != size_t(nodeCount) + 1) {
+        throw std::runtime_error("The matrix doesn't have as many rows as there are nodes");
+    }
+    std::vector<uint32_t> targets(offsets.back());
+    std::vector<int> weights(offsets.back());
+    runOnThreads(chunkCount, [&](unsigned chunk) {
+        MatrixRows &rows = chunkRows[chunk];
+        std::copy(rows.targets.begin(), rows.targets.end(), targets.begin() + chunkStarts[chunk]);
+        std::copy(rows.weights.begin(), rows.weights.end(), weights.begin() + chunkStarts[chunk]);
+        rows = MatrixRows();
+    });
+    return Graph(std::move(offsets), std::move(targets), std::move(weights));
+}
+
+// Maps fileLocation and parses it with loadGraph. Throws std::runtime_error if it can't be read
+inline Graph loadGraph(const std::string &fileLocation, unsigned threadCount) {
+    MappedFile file(fileLocation);
+    return loadGraph(file, threadCount);
+}
+
+#endif //PROJECT4_GRAPH_H
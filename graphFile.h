@@ -0,0 +1,146 @@
+#ifndef PROJECT4_GRAPHFILE_H
+#define PROJECT4_GRAPHFILE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "mappedFile.h"
+#include "graph.h"
+
+/*
+ * Binary graph file, the CSR arrays of a Graph written out as they are so loading is just mapping the file.
+ *
+ * Layout (native byte order, every section starts 8 byte aligned):
+ *      GraphFileHeader
+ *      uint64_t offsets[nodeCount + 1]  where each node's edges start, plus the end
+ *      uint32_t targets[edgeCount]      the node each edge goes to
+ *      uint8_t  weights[edgeCount]      the weight of each edge
+ *
+ * A dense graph of n nodes is about 5n^2 bytes at most against the 2n^2 characters (and a parse) of the matrix, and a
+ * sparse one only pays for the edges it has. Nothing is copied out of the mapping, so startup is a few page faults
+ * and every process with the same file open shares the same pages of the page cache.
+ */
+struct GraphFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint64_t edgeCount;
+};
+
+const char graphFileMagic[8]{'P', '4', 'G', 'R', 'A', 'P', 'H', '\0'};
+const uint32_t graphFileVersion = 1;
+
+inline bool isGraphFile(const MappedFile &file) {
+    return file.size() >= sizeof(graphFileMagic) && std::memcmp(file.begin(), graphFileMagic,
+                                                                sizeof(graphFileMagic)) == 0;
+}
+
+/*
+ * Writes graph next to its final name first and renames it into place, so another process never maps a half written
+ * file. Throws std::runtime_error if it can't be written or a weight doesn't fit in a byte.
+ */
+inline void writeGraphFile(const std::string &fileLocation, const Graph &graph) {
+    int nodeCount = graph.nodeCount();
+    uint64_t edgeCount = graph.edgeCount();
+    std::vector<uint8_t> weights(edgeCount);
+    for (uint64_t edge = 0; edge < edgeCount; edge++) {
+        int weight = graph.weight(edge);
+        if (weight < 0 || weight > UINT8_MAX) {
+            throw std::runtime_error("Edge weight " + std::to_string(weight) + " doesn't fit in a byte");
+        }
+        weights[edge] = uint8_t(weight);
+    }
+
+    std::string temporary = fileLocation + ".tmp";
+    std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw std::runtime_error("Could not write " + temporary);
+    }
+    const char padding[8]{};
+    auto writePadded = [&](const void *data, size_t bytes) {
+        ofs.write(static_cast<const char *>(data), std::streamsize(bytes));
+        ofs.write(padding, std::streamsize(alignedTo8(bytes) - bytes));
+    };
+
+    GraphFileHeader header{};
+    std::memcpy(header.magic, graphFileMagic, sizeof(header.magic));
+    header.version = graphFileVersion;
+    header.nodeCount = uint32_t(nodeCount);
+    header.edgeCount = edgeCount;
+    writePadded(&header, sizeof(header));
+
+    std::vector<uint64_t> offsets(size_t(nodeCount) + 1, 0);
+    std::vector<uint32_t> targets(edgeCount);
+    for (int node = 0; node < nodeCount; node++) {
+        offsets[node + 1] = graph.lastEdge(node);
+    }
+    for (uint64_t edge = 0; edge < edgeCount; edge++) {
+        targets[edge] = uint32_t(graph.target(edge));
+    }
+    writePadded(offsets.data(), offsets.size() * sizeof(uint64_t));
+    writePadded(targets.data(), targets.size() * sizeof(uint32_t));
+    writePadded(weights.data(), weights.size());
+
+    ofs.close();
+    if (!ofs || std::rename(temporary.c_str(), fileLocation.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write " + fileLocation);
+    }
+}
+
+/*
+ * Makes a Graph that reads straight out of a mapped binary graph file and keeps the mapping. The header, the file
+ * size and the offsets are checked, the targets are trusted, since checking them would mean reading the whole file.
+ * Throws std::runtime_error if it isn't a graph file of this version.
+ */
+inline Graph mapGraphFile(MappedFile &&file) {
+    GraphFileHeader header{};
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("Too short to be a graph file");
+    }
+    std::memcpy(&header, file.begin(), sizeof(header));
+    if (std::memcmp(header.magic, graphFileMagic, sizeof(header.magic)) != 0 || header.version != graphFileVersion ||
+        header.nodeCount > uint32_t(INT32_MAX)) {
+        throw std::runtime_error("Not a graph file this version can read");
+    }
+
+    size_t nodeCount = header.nodeCount;
+    size_t edgeCount = header.edgeCount;
+    size_t offsetsAt = alignedTo8(sizeof(GraphFileHeader));
+    size_t targetsAt = offsetsAt + alignedTo8((nodeCount + 1) * sizeof(uint64_t));
+    size_t weightsAt = targetsAt + alignedTo8(edgeCount * sizeof(uint32_t));
+    if (file.size() != weightsAt + alignedTo8(edgeCount)) {
+        throw std::runtime_error("The graph file's size doesn't match its header");
+    }
+
+    const char *base = file.begin();
+    const uint64_t *offsets = reinterpret_cast<const uint64_t *>(base + offsetsAt);
+    if (offsets[0] != 0 || offsets[nodeCount] != edgeCount ||
+        !std::is_sorted(offsets, offsets + nodeCount + 1)) {
+        throw std::runtime_error("The graph file's offsets are corrupt");
+    }
+    // Searches jump around the graph rather than reading it front to back
+    file.advise(MADV_NORMAL);
+    return Graph(std::move(file), int(nodeCount), edgeCount, offsets,
+                 reinterpret_cast<const uint32_t *>(base + targetsAt),
+                 reinterpret_cast<const uint8_t *>(base + weightsAt));
+}
+
+/*
+ * Opens either kind of graph file: a binary one is mapped as it is, a text one (see loadGraph) is parsed on
+ * threadCount threads. Throws std::runtime_error if it can't be read.
+ */
+inline Graph openGraph(const std::string &fileLocation, unsigned threadCount) {
+    MappedFile file(fileLocation);
+    if (isGraphFile(file)) {
+        return mapGraphFile(std::move(file));
+    }
+    return loadGraph(file, threadCount);
+}
+
+#endif //PROJECT4_GRAPHFILE_H
@@ -0,0 +1,137 @@
+#ifndef PROJECT4_GRAPHGENERATOR_H
+#define PROJECT4_GRAPHGENERATOR_H
+
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "parallel.h"
+#include "graph.h"
+
+// Joined sets of nodes, for telling whether a generated graph is connected yet
+class DisjointSets {
+public:
+    explicit DisjointSets(int nodeCount) : parent(size_t(nodeCount)) {
+        for (int node = 0; node < nodeCount; node++) {
+            parent[node] = node;
+        }
+    }
+
+    // The node standing for node's set, halving the path there on the way
+    int find(int node) {
+        while (parent[node] != node) {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
+    // The lower root is kept, like gengraph's b[], so node 0 always stands for its own set
+    void join(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a < b) {
+            parent[b] = a;
+        } else {
+            parent[a] = b;
+        }
+    }
+
+private:
+    std::vector<int> parent;
+};
+
+// The weights gengraph gives its edges, 1 to 5
+const int generatedMaxWeight = 5;
+
+// Pairs are drawn in chunks of this many, each from its own generator seeded with the seed and the chunk's number, so
+// any number of threads draws exactly the same pairs and a chunk can be drawn again instead of being kept
+const uint64_t generatorChunk = uint64_t(1) << 16;
+
+inline uint64_t chunkCount(uint64_t pairCount) {
+    return (pairCount + generatorChunk - 1) / generatorChunk;
+}
+
+inline std::mt19937_64 chunkGenerator(uint64_t seed, uint64_t chunk) {
+    std::seed_seq sequence{uint32_t(seed), uint32_t(seed >> 32), uint32_t(chunk), uint32_t(chunk >> 32)};
+    return std::mt19937_64(sequence);
+}
+
+// Chunk's share of pairCount random pairs of different nodes, each as one edge with a weight of 1 to 5
+inline void generateChunk(int nodeCount, uint64_t pairCount, uint64_t seed, uint64_t chunk,
+                          std::vector<Edge> &pairs) {
+    pairs.clear();
+    if (nodeCount < 2) {
+        return;
+    }
+    std::mt19937_64 rng = chunkGenerator(seed, chunk);
+    uint64_t last = std::min(pairCount, (chunk + 1) * generatorChunk);
+    for (uint64_t pair = chunk * generatorChunk; pair < last; pair++) {
+        int i = int(rng() % uint64_t(nodeCount));
+        int j = int(rng() % uint64_t(nodeCount - 1));
+        // Skipping over i keeps j uniform over the other nodes without drawing again
+        pairs.push_back({i, j >= i ? j + 1 : j, int(rng() % generatedMaxWeight) + 1});
+    }
+}
+
+/*
+ * gengraph's second pass, once sets has every random pair joined: every node that still isn't connected to node 0 is
+ * joined to a random lower node, which by then always is. The pairs that takes, from a generator of their own.
+ */
+inline std::vector<Edge> connectingPairs(int nodeCount, DisjointSets &sets, uint64_t seed) {
+    std::mt19937_64 rng = chunkGenerator(seed, ~uint64_t(0));
+    std::vector<Edge> pairs;
+    for (int node = 1; node < nodeCount; node++) {
+        if (sets.find(node) != sets.find(0)) {
+            int lower = int(rng() % uint64_t(node));
+            pairs.push_back({node, lower, int(rng() % generatedMaxWeight) + 1});
+            sets.join(node, lower);
+        }
+    }
+    return pairs;
+}
+
+/*
+ * The graph gengraph makes, as a list of edges rather than a printed matrix: pairCount random pairs of different nodes,
+ * each joined both ways by a weight of 1 to 5, then connectingPairs to make it connected. The chunks are drawn on
+ * threadCount threads. A pair that comes up twice is two edges here where gengraph would overwrite the first, which
+ * only matters for dense graphs. The same seed always gives the same graph, which is the one gengraph --sparse writes.
+ */
+inline std::vector<Edge> generateEdges(int nodeCount, uint64_t pairCount, uint64_t seed, unsigned threadCount) {
+    pairCount = nodeCount < 2 ? 0 : pairCount;
+    std::vector<Edge> edges(size_t(pairCount) * 2);
+    uint64_t chunks = chunkCount(pairCount);
+    unsigned workers = unsigned(std::max<uint64_t>(1, std::min<uint64_t>(std::max(threadCount, 1u), chunks)));
+    runOnThreads(workers, [&](unsigned worker) {
+        std::vector<Edge> pairs;
+        for (uint64_t chunk = worker; chunk < chunks; chunk += workers) {
+            generateChunk(nodeCount, pairCount, seed, chunk, pairs);
+            for (size_t i = 0; i < pairs.size(); i++) {
+                size_t at = size_t(chunk * generatorChunk + i) * 2;
+                edges[at] = pairs[i];
+                edges[at + 1] = {pairs[i].to, pairs[i].from, pairs[i].weight};
+            }
+        }
+    });
+    DisjointSets sets(nodeCount);
+    for (size_t at = 0; at < edges.size(); at += 2) {
+        sets.join(edges[at].from, edges[at].to);
+    }
+    for (auto &pair : connectingPairs(nodeCount, sets, seed)) {
+        edges.push_back(pair);
+        edges.push_back({pair.to, pair.from, pair.weight});
+    }
+    return edges;
+}
+
+// pairCount for an average of degree edges leaving every node
+inline uint64_t pairsForDegree(int nodeCount, double degree) {
+    return uint64_t(double(nodeCount) * degree / 2);
+}
+
+// pairCount for density of all the pairs of different nodes being joined (before repeats)
+inline uint64_t pairsForDensity(int nodeCount, double density) {
+    return uint64_t(double(nodeCount) * double(nodeCount - 1) / 2 * density);
+}
+
+#endif //PROJECT4_GRAPHGENERATOR_H
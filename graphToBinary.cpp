@@ -0,0 +1,46 @@
+//
+// Converts a text graph (a gengraph matrix or an edge list) into the binary graph file Task2 maps.
+//
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "graph.h"
+#include "graphFile.h"
+
+int main(int argc, char **argv) {
+    // graphToBinary [--threads n] input output
+    std::string input;
+    std::string output;
+    unsigned threadCount = hardwareThreads();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = unsigned(std::max(1, std::stoi(argv[++i])));
+        } else if (input.empty()) {
+            input = arg;
+        } else if (output.empty()) {
+            output = arg;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (output.empty()) {
+        std::cerr << "Usage: graphToBinary [--threads n] input output" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        Graph graph = openGraph(input, threadCount);
+        writeGraphFile(output, graph);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Wrote " << graph.nodeCount() << " nodes and " << graph.edgeCount() << " edges to " << output
+                  << " in " << elapsed.count() << "ms" << std::endl;
+    } catch (std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
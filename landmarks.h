@@ -0,0 +1,248 @@
+#ifndef PROJECT4_LANDMARKS_H
+#define PROJECT4_LANDMARKS_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include "mappedFile.h"
+#include "parallel.h"
+#include "graph.h"
+#include "searchQueue.h"
+
+/*
+ * A handful of landmark nodes and the exact distance from each of them to every node and from every node to each of
+ * them, for the ALT lower bound on how far a node still is from a target. By the triangle inequality, for a landmark L
+ *      d(v, t) >= d(L, t) - d(L, v)   and   d(v, t) >= d(v, L) - d(t, L)
+ * and estimate takes the best of these over all landmarks. That never overestimates and never drops by more than an
+ * edge's weight along an edge, so A* with it settles every node once just like Dijkstra, but pointed at the target.
+ *
+ * Landmarks are picked farthest first: each is the node farthest from the ones picked already, which spreads them over
+ * the edge of the graph where the bounds are tightest. The tables are either the landmarks' own or inside a mapped
+ * landmarks file (see writeLandmarks), so like Graph they're reached through pointers and can only be moved.
+ */
+class Landmarks {
+public:
+    Landmarks() = default;
+
+    // Picks count landmarks (at most one per node) of graph, reverse has to be reversed(graph)
+    Landmarks(const Graph &graph, const Graph &reverse, int count, unsigned threadCount) {
+        nodes = graph.nodeCount();
+        count = std::max(0, std::min(count, nodes));
+        landmarkIds.reserve(size_t(count));
+        tables.resize(size_t(count) * 2 * size_t(nodes));
+        std::vector<int> closest(size_t(nodes), unreachable);
+        int next = 0;
+        if (count > 0) {
+            // The first is the node farthest from node 0 rather than node 0 itself
+            next = farthest(distancesFrom(graph, 0), closest);
+        }
+        for (int i = 0; i < count; i++) {
+            landmarkIds.push_back(uint32_t(next));
+            std::vector<int> from = distancesFrom(graph, next);
+            std::copy(from.begin(), from.end(), tables.begin() + size_t(i) * nodes);
+            for (int node = 0; node < nodes; node++) {
+                closest[node] = std::min(closest[node], from[node]);
+            }
+            next = farthest(from, closest);
+        }
+        // Distances to the landmarks are distances from them in the reversed graph, and don't depend on each other
+        unsigned workers = std::max(1u, std::min(threadCount, unsigned(count)));
+        runOnThreads(workers, [&](unsigned worker) {
+            for (int i = int(worker); i < count; i += int(workers)) {
+                std::vector<int> to = distancesFrom(reverse, int(landmarkIds[i]));
+                std::copy(to.begin(), to.end(), tables.begin() + (size_t(count) + i) * nodes);
+            }
+        });
+        landmarkCount = count;
+        idData = landmarkIds.data();
+        tableData = tables.data();
+    }
+
+    // Reads the landmarks and tables straight out of file, which is kept mapped for as long as this lives
+    Landmarks(MappedFile &&file, int nodeCount, int count, const uint32_t *ids, const int *distances)
+            : mapping(std::move(file)), nodes(nodeCount), landmarkCount(count), idData(ids), tableData(distances) {}
+
+    Landmarks(const Landmarks &) = delete;
+
+    Landmarks &operator=(const Landmarks &) = delete;
+
+    Landmarks(Landmarks &&) = default;
+
+    Landmarks &operator=(Landmarks &&) = default;
+
+    inline int count() const { return landmarkCount; }
+
+    inline int nodeCount() const { return nodes; }
+
+    inline int landmark(int i) const { return int(idData[i]); }
+
+    inline int distanceFrom(int i, int node) const { return tableData[size_t(i) * nodes + node]; }
+
+    inline int distanceTo(int i, int node) const { return tableData[(size_t(landmarkCount) + i) * nodes + node]; }
+
+    // A lower bound on the distance from node to target
+    int estimate(int node, int target) const {
+        int bound = 0;
+        for (int i = 0; i < landmarkCount; i++) {
+            int fromTarget = distanceFrom(i, target);
+            int fromNode = distanceFrom(i, node);
+            if (fromTarget != unreachable && fromNode != unreachable) {
+                bound = std::max(bound, fromTarget - fromNode);
+            }
+            int toNode = distanceTo(i, node);
+            int toTarget = distanceTo(i, target);
+            if (toNode != unreachable && toTarget != unreachable) {
+                bound = std::max(bound, toNode - toTarget);
+            }
+        }
+        return bound;
+    }
+
+private:
+    // The reachable node farthest from all the landmarks, those in closest and the one distance is measured from
+    static int farthest(const std::vector<int> &distance, const std::vector<int> &closest) {
+        int best = 0;
+        int bestDistance = -1;
+        for (size_t node = 0; node < distance.size(); node++) {
+            int nearest = std::min(distance[node], closest[node]);
+            if (distance[node] != unreachable && nearest > bestDistance) {
+                best = int(node);
+                bestDistance = nearest;
+            }
+        }
+        return best;
+    }
+
+    std::vector<uint32_t> landmarkIds;
+    // The from tables of every landmark, then the to tables, each nodeCount long
+    std::vector<int> tables;
+    MappedFile mapping;
+
+    int nodes = 0;
+    int landmarkCount = 0;
+    const uint32_t *idData = nullptr;
+    const int *tableData = nullptr;
+};
+
+/*
+ * Landmarks file, kept next to the graph as <graph>.landmarks so they're only worked out once per graph.
+ *
+ * Layout (native byte order, every section starts 8 byte aligned):
+ *      LandmarksHeader
+ *      uint32_t landmarks[landmarkCount]
+ *      int32_t  distances[2][landmarkCount][nodeCount]  the distances from every landmark, then those to them
+ *
+ * Like a Task1 snapshot it remembers the size and modification time of the graph file it was made from, and goes stale
+ * when that changes.
+ */
+struct LandmarksHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t landmarkCount;
+    uint32_t unused;
+    uint64_t edgeCount;
+    uint64_t graphSize;
+    int64_t graphModified;
+};
+
+const char landmarksMagic[8]{'P', '4', 'L', 'M', 'A', 'R', 'K', '\0'};
+const uint32_t landmarksVersion = 1;
+
+/*
+ * Writes the file next to its final name first and renames it into place. Throws std::runtime_error if it can't be
+ * written.
+ */
+inline void writeLandmarks(const std::string &landmarksLocation, const std::string &graphLocation,
+                           const Graph &graph, const Landmarks &landmarks) {
+    std::string temporary = landmarksLocation + ".tmp";
+    std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw std::runtime_error("Could not write " + temporary);
+    }
+    const char padding[8]{};
+    auto writePadded = [&](const void *data, size_t bytes) {
+        ofs.write(static_cast<const char *>(data), std::streamsize(bytes));
+        ofs.write(padding, std::streamsize(alignedTo8(bytes) - bytes));
+    };
+
+    LandmarksHeader header{};
+    std::memcpy(header.magic, landmarksMagic, sizeof(header.magic));
+    header.version = landmarksVersion;
+    header.nodeCount = uint32_t(landmarks.nodeCount());
+    header.landmarkCount = uint32_t(landmarks.count());
+    header.edgeCount = graph.edgeCount();
+    auto stamp = fileStamp(graphLocation);
+    header.graphSize = stamp.first;
+    header.graphModified = stamp.second;
+    writePadded(&header, sizeof(header));
+
+    std::vector<uint32_t> ids;
+    std::vector<int> distances;
+    for (int i = 0; i < landmarks.count(); i++) {
+        ids.push_back(uint32_t(landmarks.landmark(i)));
+        for (int node = 0; node < landmarks.nodeCount(); node++) {
+            distances.push_back(landmarks.distanceFrom(i, node));
+        }
+    }
+    for (int i = 0; i < landmarks.count(); i++) {
+        for (int node = 0; node < landmarks.nodeCount(); node++) {
+            distances.push_back(landmarks.distanceTo(i, node));
+        }
+    }
+    writePadded(ids.data(), ids.size() * sizeof(uint32_t));
+    writePadded(distances.data(), distances.size() * sizeof(int));
+
+    ofs.close();
+    if (!ofs || std::rename(temporary.c_str(), landmarksLocation.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write " + landmarksLocation);
+    }
+}
+
+/*
+ * Maps a landmarks file into landmarks. Returns false, leaving landmarks untouched, when there's no file, it isn't one
+ * this version understands, it has a different number of landmarks than count, or it doesn't belong to graph as it is
+ * now.
+ */
+inline bool loadLandmarks(const std::string &landmarksLocation, const std::string &graphLocation, const Graph &graph,
+                          int count, Landmarks &landmarks) {
+    MappedFile file;
+    try {
+        file = MappedFile(landmarksLocation);
+    } catch (std::runtime_error &) {
+        return false;
+    }
+    LandmarksHeader header{};
+    if (file.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.begin(), sizeof(header));
+    auto stamp = fileStamp(graphLocation);
+    if (std::memcmp(header.magic, landmarksMagic, sizeof(header.magic)) != 0 || header.version != landmarksVersion ||
+        header.nodeCount != uint32_t(graph.nodeCount()) || header.edgeCount != graph.edgeCount() ||
+        header.landmarkCount != uint32_t(std::max(0, std::min(count, graph.nodeCount()))) ||
+        header.graphSize != stamp.first || header.graphModified != stamp.second) {
+        return false;
+    }
+
+    size_t idsAt = alignedTo8(sizeof(LandmarksHeader));
+    size_t tablesAt = idsAt + alignedTo8(header.landmarkCount * sizeof(uint32_t));
+    size_t tableBytes = 2 * size_t(header.landmarkCount) * header.nodeCount * sizeof(int);
+    if (file.size() != tablesAt + alignedTo8(tableBytes)) {
+        return false;
+    }
+    const char *base = file.begin();
+    file.advise(MADV_NORMAL);
+    landmarks = Landmarks(std::move(file), int(header.nodeCount), int(header.landmarkCount),
+                          reinterpret_cast<const uint32_t *>(base + idsAt),
+                          reinterpret_cast<const int *>(base + tablesAt));
+    return true;
+}
+
+#endif //PROJECT4_LANDMARKS_H
@@ -0,0 +1,246 @@
+#ifndef PROJECT4_LIVEINGEST_H
+#define PROJECT4_LIVEINGEST_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include "studentData.h"
+#include "studentIndex.h"
+#include "gradeQuery.h"
+
+struct GradeUpdate {
+    NameView name;
+    int subject;
+    int grade;
+};
+
+/*
+ * Keeps a loaded StudentStore, its sorted indexes and its GradeQueryIndex correct while new grade lines are applied,
+ * without ever resorting from scratch:
+ *  - subject indexes move a changed student across grade groups with GradeHistogram::regrade, which only touches the
+ *    groups between the old and the new grade
+ *  - new students start with every grade at 0, which every histogram is stretched to cover up front, so they're
+ *    slotted in like any other grade change
+ *  - a grade outside what a subject has seen so far can't be slotted in, so that subject alone is rebuilt (rare, the
+ *    grade range is normally fixed)
+ *  - new students are only collected by apply. The names index with them merged in is built by mergeNames while
+ *    commands keep running, and swapNames puts it in place, so until then find and the names listing don't have them
+ *
+ * It needs every index to exist, so anything not built yet is built on the spot when it's constructed (call buildAll on
+ * both first to do that on more threads). Nothing here locks: whoever calls apply or swapNames has to hold the store
+ * exclusively. mergeNames only reads, and everything it reads is only ever written by the thread calling apply, so
+ * that thread can call it without the lock.
+ */
+class LiveIndexes {
+public:
+    LiveIndexes(StudentStore &studentData, LazyIndexes &sortedIndexes, GradeQueryIndex &queryIndex, NameArena &arena)
+            : studentData(studentData), sortedData(sortedIndexes.all(1)), nameLookup(sortedIndexes.names()),
+              queryIndex(queryIndex), arena(arena) {
+        queryIndex.buildAll(1);
+        // apply looks every name up, and the first lookup would otherwise build the whole map under the lock
+        studentData.buildIdMap();
+        for (int index = 0; index < 5; index++) {
+            if (!queryIndex.histogram(index).covers(0)) {
+                queryIndex.rebuild(index);
+            }
+            rebuildPositions(index);
+        }
+    }
+
+    // The names index and name lookup with every student apply has added since the last swapNames merged in
+    struct NameMerge {
+        std::vector<StudentId> names;
+        SortedNameIndex lookup;
+    };
+
+    void apply(const GradeUpdate *begin, const GradeUpdate *end) {
+        std::array<bool, 5> stale{};
+        for (const GradeUpdate *update = begin; update != end; update++) {
+            StudentId id = studentData.find(update->name);
+            if (id == StudentStore::notFound) {
+                id = studentData.findOrAdd(arena.intern(update->name.data, update->name.length));
+                unmergedNames.push_back(id);
+                for (int index = 0; index < 5; index++) {
+                    // New students start with every grade at 0
+                    if (!stale[index] && queryIndex.histogram(index).covers(0)) {
+                        GradeHistogram &histogram = queryIndex.histogram(index);
+                        histogram.appendLowest(id, sortedData[index], positions[index]);
+                        histogram.regrade(id, histogram.lowest(), 0, sortedData[index], positions[index]);
+                        queryIndex.bitmap(index).addStudent(id, 0);
+                    } else {
+                        stale[index] = true;
+                    }
+                }
+            }
+            int oldGrade = studentData.grade(id, update->subject);
+            int oldTotal = studentData.grade(id, 4);
+            int newTotal = oldTotal - oldGrade + update->grade;
+            studentData.setGrade(id, update->subject, update->grade);
+            studentData.setGrade(id, 4, newTotal);
+            regrade(update->subject, id, oldGrade, update->grade, stale);
+            regrade(4, id, oldTotal, newTotal, stale);
+        }
+
+        for (int index = 0; index < 5; index++) {
+            if (stale[index]) {
+                sortedData[index] = countingSortIndex(studentData.column(index));
+                rebuildPositions(index);
+                queryIndex.rebuild(index);
+            }
+        }
+    }
+
+    inline bool namesPending() const { return !unmergedNames.empty(); }
+
+    // One pass over the names, which is why it's done once for many batches and outside the exclusive lock
+    NameMerge mergeNames() const {
+        NameMerge merge;
+        std::vector<StudentId> added = unmergedNames;
+        CompareKeys comp(studentData.nameColumn());
+        std::sort(added.begin(), added.end(), comp);
+        const std::vector<StudentId> &names = sortedData[namesIndex];
+        merge.names.reserve(names.size() + added.size());
+        std::merge(names.begin(), names.end(), added.begin(), added.end(), std::back_inserter(merge.names), comp);
+        merge.lookup = nameLookup.merged(studentData, added);
+        return merge;
+    }
+
+    // merge has to come from mergeNames with no apply since. O(1), the old arrays are freed after the lock is let go
+    void swapNames(NameMerge &merge) {
+        sortedData[namesIndex].swap(merge.names);
+        std::swap(nameLookup, merge.lookup);
+        unmergedNames.clear();
+    }
+
+private:
+    void regrade(int index, StudentId id, int from, int to, std::array<bool, 5> &stale) {
+        if (stale[index] || from == to) {
+            return;
+        }
+        GradeHistogram &histogram = queryIndex.histogram(index);
+        if (!histogram.covers(to)) {
+            stale[index] = true;
+            return;
+        }
+        histogram.regrade(id, from, to, sortedData[index], positions[index]);
+        queryIndex.bitmap(index).regrade(id, from, to);
+    }
+
+    void rebuildPositions(int index) {
+        positions[index].resize(studentData.size());
+        for (StudentId i = 0; i < sortedData[index].size(); i++) {
+            positions[index][sortedData[index][i]] = i;
+        }
+    }
+
+    StudentStore &studentData;
+    sortedDataStruct &sortedData;
+    SortedNameIndex &nameLookup;
+    GradeQueryIndex &queryIndex;
+    NameArena &arena;
+    // positions[index][id] is where id is in sortedData[index]
+    std::array<std::vector<StudentId>, 5> positions;
+    std::vector<StudentId> unmergedNames;
+};
+
+/*
+ * Follows a grade file like tail -f from a byte offset onwards, on its own thread. Complete lines are parsed outside
+ * the lock and then applied through LiveIndexes in batches of at most batchSize updates, each batch under an exclusive
+ * lock of storeMutex. Readers are therefore only ever held up for one small batch at a time, however much arrives.
+ * New names are merged into the names index once everything read has been applied, and only swapped in under the lock.
+ *
+ * Works on pipes too; the descriptor is non blocking so an idle pipe is polled the same way as a file that hasn't grown.
+ */
+class GradeFileTail {
+public:
+    static constexpr size_t batchSize = 4096;
+
+    GradeFileTail(const std::string &fileLocation, uint64_t startOffset, LiveIndexes &live,
+                  std::shared_timed_mutex &storeMutex)
+            : live(live), storeMutex(storeMutex) {
+        fd = ::open(fileLocation.c_str(), O_RDONLY | O_NONBLOCK);
+        if (fd < 0) {
+            throw std::runtime_error("Could not follow " + fileLocation);
+        }
+        ::lseek(fd, off_t(startOffset), SEEK_SET);
+        worker = std::thread(&GradeFileTail::run, this);
+    }
+
+    ~GradeFileTail() {
+        stopping = true;
+        worker.join();
+        ::close(fd);
+    }
+
+    GradeFileTail(const GradeFileTail &) = delete;
+
+    GradeFileTail &operator=(const GradeFileTail &) = delete;
+
+    inline uint64_t linesApplied() const { return applied; }
+
+private:
+    void run() {
+        std::vector<char> pending;
+        std::vector<GradeUpdate> updates;
+        char buffer[1 << 16];
+        while (!stopping) {
+            ssize_t bytesRead = ::read(fd, buffer, sizeof(buffer));
+            if (bytesRead <= 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            pending.insert(pending.end(), buffer, buffer + bytesRead);
+            // Only whole lines are applied, a partial one waits for the rest of it
+            auto lastNewline = std::find(pending.rbegin(), pending.rend(), '\n');
+            if (lastNewline == pending.rend()) {
+                continue;
+            }
+            const char *linesEnd = pending.data() + (pending.rend() - lastNewline);
+            updates.clear();
+            forEachGradeLine(pending.data(), linesEnd, [&updates](NameView name, int subject, int grade) {
+                updates.push_back({name, subject, grade});
+            });
+            for (size_t first = 0; first < updates.size(); first += batchSize) {
+                size_t last = std::min(updates.size(), first + batchSize);
+                std::unique_lock<std::shared_timed_mutex> lock(storeMutex);
+                live.apply(updates.data() + first, updates.data() + last);
+                applied += last - first;
+            }
+            if (live.namesPending()) {
+                LiveIndexes::NameMerge merge = live.mergeNames();
+                {
+                    std::unique_lock<std::shared_timed_mutex> lock(storeMutex);
+                    live.swapNames(merge);
+                }
+            }
+            pending.erase(pending.begin(), pending.begin() + (linesEnd - pending.data()));
+        }
+    }
+
+    LiveIndexes &live;
+    std::shared_timed_mutex &storeMutex;
+    int fd = -1;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> applied{0};
+    std::thread worker;
+};
+
+// Where the last complete line of a mapped file ends, following should pick up from there
+inline uint64_t completeLinesEnd(const MappedFile &file) {
+    const char *pos = file.end();
+    while (pos > file.begin() && pos[-1] != '\n') {
+        pos--;
+    }
+    return uint64_t(pos - file.begin());
+}
+
+#endif //PROJECT4_LIVEINGEST_H
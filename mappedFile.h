@@ -0,0 +1,187 @@
+#ifndef PROJECT4_MAPPEDFILE_H
+#define PROJECT4_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Read only view of an entire file through mmap. Nothing gets copied into the process; the kernel pages the file in as
+ * it is touched, which means the tokenisers below can work on the bytes in place instead of going through >> and
+ * allocating a std::string for every token.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string &fileLocation) {
+        int fd = ::open(fileLocation.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + fileLocation);
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Could not stat " + fileLocation);
+        }
+        length = size_t(info.st_size);
+        // mmap refuses zero length mappings, an empty file is just an empty range
+        if (length > 0) {
+            void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Could not map " + fileLocation);
+            }
+            ::madvise(mapping, length, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapping);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept: data(other.data), length(other.length) {
+        other.data = nullptr;
+        other.length = 0;
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            unmap();
+            data = other.data;
+            length = other.length;
+            other.data = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    inline const char *begin() const { return data; }
+
+    inline const char *end() const { return data + length; }
+
+    inline size_t size() const { return length; }
+
+    // Replaces the MADV_SEQUENTIAL read ahead hint for files that aren't read front to back
+    void advise(int advice) const {
+        if (data) {
+            ::madvise(const_cast<char *>(data), length, advice);
+        }
+    }
+
+private:
+    void unmap() {
+        if (data) {
+            ::munmap(const_cast<char *>(data), length);
+        }
+        data = nullptr;
+        length = 0;
+    }
+
+    const char *data = nullptr;
+    size_t length = 0;
+};
+
+// Whether fileLocation can be stat'ed, which an empty file can be even though its fileStamp size is zero
+inline bool fileExists(const std::string &fileLocation) {
+    struct stat info{};
+    return ::stat(fileLocation.c_str(), &info) == 0;
+}
+
+// Size and modification time (in nanoseconds) of a file, both zero if it doesn't exist
+inline std::pair<uint64_t, int64_t> fileStamp(const std::string &fileLocation) {
+    struct stat info{};
+    if (::stat(fileLocation.c_str(), &info) != 0) {
+        return {0, 0};
+    }
+    return {uint64_t(info.st_size), int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec};
+}
+
+// Sections of the binary files that get mapped start on 8 byte boundaries
+inline size_t alignedTo8(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+/*
+ * Hand written scanners for mapped text. Each one takes the current position and the end of the buffer and returns
+ * where it stopped, so callers can walk a whole file without ever building a stream.
+ */
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+inline const char *skipBlanks(const char *pos, const char *end) {
+    while (pos < end && isBlank(*pos)) {
+        pos++;
+    }
+    return pos;
+}
+
+// Skips leading whitespace and returns the start of the next token, tokenEnd is set to one past its last character
+inline const char *scanToken(const char *pos, const char *end, const char *&tokenEnd) {
+    pos = skipBlanks(pos, end);
+    tokenEnd = pos;
+    while (tokenEnd < end && !isBlank(*tokenEnd)) {
+        tokenEnd++;
+    }
+    return pos;
+}
+
+/*
+ * Parses an optionally signed decimal int. Returns nullptr when there are no digits at pos (after whitespace), or when
+ * the number doesn't fit in an int, so a caller treats an overlong number like any other malformed token.
+ */
+inline const char *scanInt(const char *pos, const char *end, int &value) {
+    pos = skipBlanks(pos, end);
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        negative = *pos == '-';
+        pos++;
+    }
+    if (pos == end || unsigned(*pos - '0') > 9) {
+        return nullptr;
+    }
+    // Wide enough that one more digit past the limit can't overflow it
+    int64_t result = 0;
+    int64_t limit = negative ? -int64_t(INT_MIN) : INT_MAX;
+    while (pos < end && unsigned(*pos - '0') <= 9) {
+        result = result * 10 + (*pos - '0');
+        if (result > limit) {
+            return nullptr;
+        }
+        pos++;
+    }
+    value = int(negative ? -result : result);
+    return pos;
+}
+
+// Cuts [begin, end) into parts pieces of about the same size, moving every cut forward to just after a newline
+inline std::vector<const char *> splitAtLines(const char *begin, const char *end, unsigned parts) {
+    std::vector<const char *> bounds{begin};
+    for (unsigned i = 1; i < parts; i++) {
+        const char *cut = std::max(begin + (end - begin) * i / parts, bounds.back());
+        while (cut > begin && cut < end && cut[-1] != '\n') {
+            cut++;
+        }
+        bounds.push_back(cut);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+#endif //PROJECT4_MAPPEDFILE_H
@@ -0,0 +1,152 @@
+#ifndef PROJECT4_NAMEINDEX_H
+#define PROJECT4_NAMEINDEX_H
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include "studentData.h"
+
+/*
+ * Every name packed back to back in one array in alphabetical order, with offsets[i] where the i-th name starts and
+ * ids[i] the student it belongs to. That's 8 bytes a student plus the name itself, where a hash node costs a pointer,
+ * a cached hash, a NameView and the bucket slot pointing at it, and every lookup is a binary search over memory that's
+ * in the same order as the names. Being sorted it also answers what a hash can't: everyone starting with a prefix, or
+ * everyone between two names.
+ *
+ * Positions are places in alphabetical order, the same order as the names index.
+ */
+class SortedNameIndex {
+public:
+    SortedNameIndex() = default;
+
+    // order has to be every id of studentData sorted by name, the names index for instance
+    SortedNameIndex(const StudentStore &studentData, const std::vector<StudentId> &order) {
+        size_t totalBytes = 0;
+        for (StudentId id : order) {
+            totalBytes += studentData.name(id).length;
+        }
+        checkFits(totalBytes);
+        bytes.reserve(totalBytes);
+        offsets.reserve(order.size() + 1);
+        ids = order;
+        for (StudentId id : order) {
+            append(studentData.name(id));
+        }
+        offsets.push_back(uint32_t(bytes.size()));
+    }
+
+    inline size_t size() const { return ids.size(); }
+
+    inline StudentId id(size_t position) const { return ids[position]; }
+
+    inline NameView name(size_t position) const {
+        return NameView(bytes.data() + offsets[position], offsets[position + 1] - offsets[position]);
+    }
+
+    // The first position whose name isn't before name
+    size_t lowerBound(const NameView &name) const {
+        return partitionPoint([&](size_t position) { return this->name(position) < name; });
+    }
+
+    // The first position whose name is after name
+    size_t upperBound(const NameView &name) const {
+        return partitionPoint([&](size_t position) { return !(name < this->name(position)); });
+    }
+
+    StudentId find(const NameView &name) const {
+        size_t position = lowerBound(name);
+        return position < size() && this->name(position) == name ? ids[position] : StudentStore::notFound;
+    }
+
+    // Positions [first, second) of everyone whose name starts with prefix
+    std::pair<size_t, size_t> prefix(const NameView &prefix) const {
+        auto comparePrefix = [&](size_t position) {
+            NameView name = this->name(position);
+            int result = std::memcmp(name.data, prefix.data, std::min(name.length, prefix.length));
+            return result != 0 ? result : (name.length < prefix.length ? -1 : 0);
+        };
+        size_t first = partitionPoint([&](size_t position) { return comparePrefix(position) < 0; });
+        size_t last = partitionPoint([&](size_t position) { return comparePrefix(position) <= 0; });
+        return {first, last};
+    }
+
+    // Positions [first, second) of everyone from from to to, both included
+    std::pair<size_t, size_t> range(const NameView &from, const NameView &to) const {
+        size_t first = lowerBound(from);
+        return {first, std::max(first, upperBound(to))};
+    }
+
+    /*
+     * A copy with students that were added to studentData since merged in, newIds sorted by name. One pass over
+     * everything like merging into the names index, so it's meant for batches, and it leaves this one alone so it can
+     * be built while this one is still being read and swapped in afterwards.
+     */
+    SortedNameIndex merged(const StudentStore &studentData, const std::vector<StudentId> &newIds) const {
+        SortedNameIndex result;
+        size_t totalBytes = bytes.size();
+        for (StudentId id : newIds) {
+            totalBytes += studentData.name(id).length;
+        }
+        checkFits(totalBytes);
+        result.bytes.reserve(totalBytes);
+        result.offsets.reserve(ids.size() + newIds.size() + 1);
+        result.ids.reserve(ids.size() + newIds.size());
+
+        size_t i = 0;
+        size_t j = 0;
+        while (i < ids.size() || j < newIds.size()) {
+            if (j == newIds.size() || (i < ids.size() && !(studentData.name(newIds[j]) < name(i)))) {
+                result.ids.push_back(ids[i]);
+                result.append(name(i++));
+            } else {
+                result.ids.push_back(newIds[j]);
+                result.append(studentData.name(newIds[j++]));
+            }
+        }
+        result.offsets.push_back(uint32_t(result.bytes.size()));
+        return result;
+    }
+
+    size_t memoryBytes() const {
+        return bytes.capacity() + offsets.capacity() * sizeof(uint32_t) + ids.capacity() * sizeof(StudentId);
+    }
+
+private:
+    // The first position where before(position) is false, before has to be true for a prefix of the positions
+    template<class Before>
+    size_t partitionPoint(Before before) const {
+        size_t first = 0;
+        size_t count = size();
+        while (count > 0) {
+            size_t half = count / 2;
+            if (before(first + half)) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        return first;
+    }
+
+    void append(const NameView &name) {
+        offsets.push_back(uint32_t(bytes.size()));
+        bytes.insert(bytes.end(), name.data, name.data + name.length);
+    }
+
+    // Offsets are 32 bit to keep them small, which caps all the names together at 4 GiB
+    static void checkFits(size_t totalBytes) {
+        if (totalBytes > UINT32_MAX) {
+            throw std::length_error("Names take up more than 4 GiB");
+        }
+    }
+
+    std::vector<char> bytes;
+    std::vector<uint32_t> offsets;
+    std::vector<StudentId> ids;
+};
+
+#endif //PROJECT4_NAMEINDEX_H
@@ -0,0 +1,232 @@
+#ifndef PROJECT4_PARALLEL_H
+#define PROJECT4_PARALLEL_H
+
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+// Nanoseconds of steady_clock since start
+inline uint64_t elapsedNanoseconds(std::chrono::steady_clock::time_point start) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                            .count());
+}
+
+// How many threads to use when the user doesn't say. hardware_concurrency is allowed to return 0 if it doesn't know
+inline unsigned hardwareThreads() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+/*
+ * Runs work(0) ... work(count - 1) on count threads and waits for all of them. The calling thread does work(0) itself
+ * rather than sitting idle in join.
+ */
+template<class Work>
+void runOnThreads(unsigned count, Work work) {
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (unsigned i = 1; i < count; i++) {
+        threads.emplace_back(work, i);
+    }
+    if (count > 0) {
+        work(0u);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * threadCount - 1 threads kept waiting for the length of a search made of many short parallel steps (BFS levels, delta
+ * stepping rounds), so a step costs waking them and waiting on them rather than starting and joining threads. run is
+ * runOnThreads on those threads, the calling thread again doing work(0).
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threadCount) : count(std::max(threadCount, 1u)) {
+        threads.reserve(count - 1);
+        for (unsigned worker = 1; worker < count; worker++) {
+            threads.emplace_back([this, worker]() { serve(worker); });
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    unsigned size() const {
+        return count;
+    }
+
+    /*
+     * Runs work(0) ... work(size() - 1) and returns once all of them have, with everything they wrote visible. Given
+     * parallel false they're all run one after another on the calling thread instead, which is cheaper for a step
+     * too small to be worth waking anyone for.
+     */
+    template<class Work>
+    void run(Work work, bool parallel = true) {
+        if (!parallel || count == 1) {
+            for (unsigned worker = 0; worker < count; worker++) {
+                work(worker);
+            }
+            return;
+        }
+        std::function<void(unsigned)> job = std::ref(work);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &job;
+            running = count - 1;
+            generation++;
+        }
+        wake.notify_all();
+        work(0u);
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() { return running == 0; });
+    }
+
+private:
+    void serve(unsigned worker) {
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(unsigned)> *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                job = current;
+            }
+            (*job)(worker);
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                last = --running == 0;
+            }
+            if (last) {
+                finished.notify_one();
+            }
+        }
+    }
+
+    unsigned count;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    // The step being run, a new generation for every one
+    const std::function<void(unsigned)> *current = nullptr;
+    uint64_t generation = 0;
+    unsigned running = 0;
+    bool stopping = false;
+};
+
+/*
+ * Calls produce(i) for every i in [0, count) on threadCount worker threads, and hands each result to consume(i, result)
+ * on the calling thread strictly in order of i, as soon as it and everything before it is done. Workers stay at most
+ * window items ahead of consume, which bounds how many results are held at once.
+ */
+template<class Result, class Produce, class Consume>
+void orderedParallelFor(size_t count, unsigned threadCount, size_t window, Produce produce, Consume consume) {
+    window = std::max<size_t>(window, 1);
+    std::mutex mutex;
+    std::condition_variable resultReady;
+    std::condition_variable slotFree;
+    std::vector<Result> slots(window);
+    std::vector<char> filled(window, 0);
+    size_t next = 0;
+    size_t consumed = 0;
+
+    auto worker = [&]() {
+        while (true) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slotFree.wait(lock, [&]() { return next >= count || next < consumed + window; });
+                if (next >= count) {
+                    return;
+                }
+                i = next++;
+            }
+            Result result = produce(i);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[i % window] = std::move(result);
+                filled[i % window] = 1;
+            }
+            resultReady.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::max(threadCount, 1u); t++) {
+        workers.emplace_back(worker);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            resultReady.wait(lock, [&]() { return filled[i % window] != 0; });
+            result = std::move(slots[i % window]);
+            filled[i % window] = 0;
+            consumed = i + 1;
+        }
+        slotFree.notify_all();
+        consume(i, result);
+    }
+    for (auto &thread : workers) {
+        thread.join();
+    }
+}
+
+/*
+ * Runs work on a thread of its own and waits for it when it goes out of scope, so it has to be declared after anything
+ * work uses.
+ */
+class BackgroundTask {
+public:
+    BackgroundTask() = default;
+
+    template<class Work>
+    explicit BackgroundTask(Work work) : thread(work) {}
+
+    BackgroundTask(BackgroundTask &&) = default;
+
+    BackgroundTask &operator=(BackgroundTask &&other) {
+        wait();
+        thread = std::move(other.thread);
+        return *this;
+    }
+
+    ~BackgroundTask() {
+        wait();
+    }
+
+    void wait() {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+private:
+    std::thread thread;
+};
+
+#endif //PROJECT4_PARALLEL_H
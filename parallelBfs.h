@@ -0,0 +1,159 @@
+#ifndef PROJECT4_PARALLELBFS_H
+#define PROJECT4_PARALLELBFS_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "parallel.h"
+#include "graph.h"
+
+// What a level synchronous BFS found: parent[node] is where it was reached from (-1 if it wasn't, source for source)
+struct BfsTree {
+    std::vector<int> parent;
+    // Nodes that joined a frontier and nodes a frontier was expanded from, like the pushes and pops of a queue
+    uint64_t discovered = 0;
+    uint64_t expanded = 0;
+    // Edges looked at, whole lists top down but only up to the first frontier node bottom up
+    uint64_t scanned = 0;
+    int topDownLevels = 0;
+    int bottomUpLevels = 0;
+};
+
+// Top down levels whose frontier has fewer edges than this are run on the calling thread rather than shared out
+const uint64_t bfsParallelEdges = 4096;
+
+// Beamer's thresholds: go bottom up when the frontier has more than 1/alpha of the unexplored edges, back top down
+// when it has fewer than 1/beta of the nodes
+const uint64_t bfsAlpha = 14;
+const uint64_t bfsBeta = 24;
+
+/*
+ * Breadth first search a level at a time, each level on threadCount threads from one WorkerPool for the whole search,
+ * stopping after the level that reaches target (or when everything reachable is, if target is -1). Hops only, weights
+ * are ignored.
+ *
+ * A level goes one of two ways (Beamer, Asanovic and Patterson, "Direction-optimizing breadth-first search"):
+ *  - top down: every frontier node looks at its edges and claims the unvisited ones with an atomic or into the visited
+ *    bitmap, the thread whose or set the bit being the one that writes the parent
+ *  - bottom up: every unvisited node looks at its incoming edges (the edges of reverse) for any node in the frontier
+ *    bitmap and stops at the first, so once the frontier is a big part of the graph most edges are never looked at.
+ *    Each thread owns whole words of the bitmaps here, so nothing needs to be atomic
+ * Without reverse every level is top down.
+ */
+inline BfsTree levelSynchronousBfs(const Graph &graph, const Graph *reverse, int source, int target,
+                                   unsigned threadCount) {
+    int nodeCount = graph.nodeCount();
+    size_t words = (size_t(nodeCount) + 63) / 64;
+    std::unique_ptr<std::atomic<uint64_t>[]> visited(new std::atomic<uint64_t>[words]);
+    for (size_t word = 0; word < words; word++) {
+        visited[word].store(0, std::memory_order_relaxed);
+    }
+    std::vector<uint64_t> inFrontier(words, 0);
+    BfsTree tree;
+    tree.parent.assign(size_t(nodeCount), -1);
+    tree.parent[source] = source;
+    visited[size_t(source) / 64].fetch_or(uint64_t(1) << (source % 64));
+    tree.discovered = 1;
+
+    std::vector<int> frontier{source};
+    uint64_t frontierEdges = graph.lastEdge(source) - graph.firstEdge(source);
+    uint64_t unexploredEdges = graph.edgeCount() - frontierEdges;
+    bool bottomUp = false;
+    WorkerPool pool(threadCount);
+    unsigned workers = pool.size();
+    std::vector<std::vector<int>> found(workers);
+    // Each worker counts into a local and adds it to its own slot once a level
+    std::vector<uint64_t> scanned(workers, 0);
+
+    auto isVisited = [&](int node) {
+        return (visited[size_t(node) / 64].load(std::memory_order_relaxed) >> (node % 64)) & 1;
+    };
+    while (!frontier.empty() && (target < 0 || !isVisited(target))) {
+        if (reverse && !bottomUp && frontierEdges > unexploredEdges / bfsAlpha) {
+            bottomUp = true;
+        } else if (bottomUp && frontier.size() < size_t(nodeCount) / bfsBeta) {
+            bottomUp = false;
+        }
+        tree.expanded += frontier.size();
+
+        if (bottomUp) {
+            tree.bottomUpLevels++;
+            std::fill(inFrontier.begin(), inFrontier.end(), 0);
+            for (int node : frontier) {
+                inFrontier[size_t(node) / 64] |= uint64_t(1) << (node % 64);
+            }
+            pool.run([&](unsigned worker) {
+                std::vector<int> &mine = found[worker];
+                mine.clear();
+                uint64_t looked = 0;
+                size_t firstWord = words * worker / workers;
+                size_t lastWord = words * (worker + 1) / workers;
+                for (size_t word = firstWord; word < lastWord; word++) {
+                    uint64_t seen = visited[word].load(std::memory_order_relaxed);
+                    for (int bit = 0; bit < 64 && word * 64 + bit < size_t(nodeCount); bit++) {
+                        if ((seen >> bit) & 1) {
+                            continue;
+                        }
+                        int node = int(word * 64 + bit);
+                        for (uint64_t edge = reverse->firstEdge(node); edge < reverse->lastEdge(node); edge++) {
+                            looked++;
+                            int from = reverse->target(edge);
+                            if ((inFrontier[size_t(from) / 64] >> (from % 64)) & 1) {
+                                tree.parent[node] = from;
+                                seen |= uint64_t(1) << bit;
+                                mine.push_back(node);
+                                break;
+                            }
+                        }
+                    }
+                    visited[word].store(seen, std::memory_order_relaxed);
+                }
+                scanned[worker] += looked;
+            });
+        } else {
+            tree.topDownLevels++;
+            pool.run([&](unsigned worker) {
+                std::vector<int> &mine = found[worker];
+                mine.clear();
+                uint64_t looked = 0;
+                size_t first = frontier.size() * worker / workers;
+                size_t last = frontier.size() * (worker + 1) / workers;
+                for (size_t i = first; i < last; i++) {
+                    int current = frontier[i];
+                    looked += graph.lastEdge(current) - graph.firstEdge(current);
+                    for (uint64_t edge = graph.firstEdge(current); edge < graph.lastEdge(current); edge++) {
+                        int neigh = graph.target(edge);
+                        uint64_t bit = uint64_t(1) << (neigh % 64);
+                        std::atomic<uint64_t> &word = visited[size_t(neigh) / 64];
+                        if (!(word.load(std::memory_order_relaxed) & bit) &&
+                            !(word.fetch_or(bit, std::memory_order_relaxed) & bit)) {
+                            tree.parent[neigh] = current;
+                            mine.push_back(neigh);
+                        }
+                    }
+                }
+                scanned[worker] += looked;
+            }, frontierEdges >= bfsParallelEdges);
+        }
+
+        // run waited for every worker, so their parents and lists are all visible here
+        frontier.clear();
+        for (auto &mine : found) {
+            frontier.insert(frontier.end(), mine.begin(), mine.end());
+        }
+        frontierEdges = 0;
+        for (int node : frontier) {
+            frontierEdges += graph.lastEdge(node) - graph.firstEdge(node);
+        }
+        unexploredEdges -= std::min(unexploredEdges, frontierEdges);
+        tree.discovered += frontier.size();
+    }
+    for (uint64_t count : scanned) {
+        tree.scanned += count;
+    }
+    return tree;
+}
+
+#endif //PROJECT4_PARALLELBFS_H
@@ -0,0 +1,217 @@
+#ifndef PROJECT4_RESULTWRITER_H
+#define PROJECT4_RESULTWRITER_H
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include "studentData.h"
+
+enum class OutputFormat {
+    table, csv, tsv
+};
+
+// The format called name by the format command, false (leaving format alone) if there's no such format
+inline bool formatFromName(const std::string &name, OutputFormat &format) {
+    if (name == "table") {
+        format = OutputFormat::table;
+    } else if (name == "csv") {
+        format = OutputFormat::csv;
+    } else if (name == "tsv") {
+        format = OutputFormat::tsv;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Formats results into one big reusable buffer instead of pushing every field through std::cout. Nothing is flushed
+ * per row: the buffer is written to the sink once it passes flushAt bytes, and when flush() is called at the end of a
+ * command. Without a sink everything stays in the buffer, which is how batch queries collect their output.
+ */
+class ResultWriter {
+public:
+    explicit ResultWriter(std::ostream *sink = nullptr, size_t flushAt = 1 << 20)
+            : sink(sink), flushAt(flushAt) {
+        if (sink) {
+            buffer.reserve(flushAt + 256);
+        }
+    }
+
+    ~ResultWriter() {
+        flush();
+    }
+
+    ResultWriter(const ResultWriter &) = delete;
+
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    inline void setFormat(OutputFormat newFormat) { outputFormat = newFormat; }
+
+    inline OutputFormat format() const { return outputFormat; }
+
+    // The column names, for the formats that have them. Called once before the rows of a listing
+    void beginListing() {
+        if (outputFormat == OutputFormat::csv) {
+            buffer += "name,biology,maths,chemistry,physics,total\n";
+        } else if (outputFormat == OutputFormat::tsv) {
+            buffer += "name\tbiology\tmaths\tchemistry\tphysics\ttotal\n";
+        }
+    }
+
+    void student(const StudentStore &studentData, StudentId id) {
+        int grades[5];
+        for (int subject = 0; subject < 5; subject++) {
+            grades[subject] = studentData.grade(id, subject);
+        }
+        student(studentData.name(id), grades);
+    }
+
+    void student(const NameView &name, const int (&grades)[5]) {
+        if (outputFormat == OutputFormat::table) {
+            // Same layout printStudent always had with std::setw
+            buffer += "Name: ";
+            buffer.append(name.data, name.length);
+            if (name.length < 12) {
+                buffer.append(12 - name.length, ' ');
+            }
+            static const char *const labels[5]{" | Biology grade: ", " | Mathematics grade: ",
+                                               " | Chemistry grade: ", " | Physics grade: ", " | Total grade: "};
+            for (int subject = 0; subject < 5; subject++) {
+                buffer += labels[subject];
+                appendInt(grades[subject]);
+            }
+        } else {
+            char separator = outputFormat == OutputFormat::csv ? ',' : '\t';
+            if (outputFormat == OutputFormat::csv) {
+                appendCsvField(name);
+            } else {
+                buffer.append(name.data, name.length);
+            }
+            for (int subject = 0; subject < 5; subject++) {
+                buffer += separator;
+                appendInt(grades[subject]);
+            }
+        }
+        buffer += '\n';
+        flushIfFull();
+    }
+
+    ResultWriter &operator<<(const char *text) {
+        buffer += text;
+        flushIfFull();
+        return *this;
+    }
+
+    ResultWriter &operator<<(const std::string &text) {
+        buffer += text;
+        flushIfFull();
+        return *this;
+    }
+
+    ResultWriter &operator<<(const NameView &name) {
+        buffer.append(name.data, name.length);
+        return *this;
+    }
+
+    ResultWriter &operator<<(char c) {
+        buffer += c;
+        return *this;
+    }
+
+    template<class Integer, class = typename std::enable_if<std::is_integral<Integer>::value>::type>
+    ResultWriter &operator<<(Integer value) {
+        appendInt(value);
+        return *this;
+    }
+
+    ResultWriter &operator<<(double value) {
+        char text[32];
+        int length = std::snprintf(text, sizeof(text), "%g", value);
+        buffer.append(text, size_t(length));
+        return *this;
+    }
+
+    // Hands everything buffered so far to the sink. Without one this does nothing
+    void flush() {
+        if (sink && !buffer.empty()) {
+            sink->write(buffer.data(), std::streamsize(buffer.size()));
+            sink->flush();
+            flushed += buffer.size();
+            buffer.clear();
+        }
+    }
+
+    inline const std::string &contents() const { return buffer; }
+
+    // Everything formatted so far, whether it's still in the buffer or not
+    inline size_t written() const { return flushed + buffer.size(); }
+
+    inline void clear() {
+        flushed += buffer.size();
+        buffer.clear();
+    }
+
+    // Moves the buffered output out, leaving the writer empty
+    std::string take() {
+        std::string taken;
+        taken.swap(buffer);
+        flushed += taken.size();
+        return taken;
+    }
+
+private:
+    template<class Integer>
+    void appendInt(Integer value) {
+        char digits[24];
+        char *end = digits + sizeof(digits);
+        char *start = end;
+        bool negative = value < 0;
+        // Work in unsigned so the most negative value doesn't overflow when negated
+        typename std::make_unsigned<Integer>::type magnitude = negative ? 0 - static_cast<
+                typename std::make_unsigned<Integer>::type>(value) : value;
+        do {
+            *--start = char('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (negative) {
+            *--start = '-';
+        }
+        buffer.append(start, size_t(end - start));
+    }
+
+    void appendCsvField(const NameView &name) {
+        bool needsQuotes = false;
+        for (uint32_t i = 0; i < name.length && !needsQuotes; i++) {
+            needsQuotes = name.data[i] == ',' || name.data[i] == '"';
+        }
+        if (!needsQuotes) {
+            buffer.append(name.data, name.length);
+            return;
+        }
+        buffer += '"';
+        for (uint32_t i = 0; i < name.length; i++) {
+            if (name.data[i] == '"') {
+                buffer += '"';
+            }
+            buffer += name.data[i];
+        }
+        buffer += '"';
+    }
+
+    inline void flushIfFull() {
+        if (sink && buffer.size() >= flushAt) {
+            flush();
+        }
+    }
+
+    std::ostream *sink;
+    size_t flushAt;
+    size_t flushed = 0;
+    std::string buffer;
+    OutputFormat outputFormat = OutputFormat::table;
+};
+
+#endif //PROJECT4_RESULTWRITER_H
@@ -0,0 +1,363 @@
+#ifndef PROJECT4_SEARCH_H
+#define PROJECT4_SEARCH_H
+
+#include <iostream>
+#include <limits>
+#include <stack>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include "graph.h"
+#include "searchQueue.h"
+#include "landmarks.h"
+#include "searchScratch.h"
+#include "parallelBfs.h"
+#include "deltaStepping.h"
+
+/*
+ * Given a source and target vertex, find the best path
+ *
+ * Output:
+ *      - Number of hops for the shortest path
+ *      - Total length of shortest path
+ *      - Number of nodeCount added to the structure
+ *      - Number of nodeCount popped from the stack
+ *      - Number of edges looked at and of those that lowered a cost (relaxations), which benchmarkTask2 reports
+ *      - Time taken to find the shortest path
+ *
+ * - Iterative Search: stack
+ * - Breadth first Search: queue
+ * - Uniform cost Search: Dijkstra on a bucket queue (or an indexed heap for heavy weights), see searchQueue.h
+ * - Bidirectional Search: Dijkstra from both ends at once until they meet
+ * - A* Search: Dijkstra steered towards the target by landmark lower bounds, see landmarks.h
+ * - Fewest hops Search: level synchronous BFS on several threads, see parallelBfs.h
+ * - Delta stepping Search: buckets of tentative distances relaxed on several threads, see deltaStepping.h
+ *
+ * 1 mark: implementing required data structures
+ * 2 marks: implementing one Search xFirstSearchAlgorithm
+ * 1 mark: statistics collected
+ * 1 mark: other two algorithms
+ */
+
+// What xFirstSearchAlgorithm is told to run for the searches that aren't a queue
+struct Bidirectional {
+};
+struct LandmarkAStar {
+};
+struct FewestHops {
+};
+struct DeltaStepping {
+};
+
+class Search {
+public:
+    // Reading the graph used to be the biggest bottleneck in the program (~33% of it went into ifs >>), so it's now
+    // parsed once up front by loadGraph and every search shares it. Bidirectional search needs reverse, the graph with
+    // its edges turned around, and A* needs landmarks. Searches run in scratch when they're given some, which is how a
+    // batch of them avoids setting up node count sized arrays for every one
+    Search(int source, int target, const Graph &graph, const Graph *reverse = nullptr,
+           const Landmarks *landmarks = nullptr, SearchScratch *scratch = nullptr)
+            : source(source), target(target), nodeCount(graph.nodeCount()), graph(graph), reverse(reverse),
+              landmarks(landmarks), scratch(scratch) {
+        if (!scratch) {
+            ownScratch.reset(new SearchScratch(graph));
+            this->scratch = ownScratch.get();
+        }
+    }
+
+    template<class T>
+    void doSearch() {
+        auto start = std::chrono::steady_clock::now();
+        scratch->reset();
+        StampedArray<int> &parent = scratch->parent;
+        StampedArray<int> &cost = scratch->cost;
+        cost[source] = 0;
+
+        xFirstSearchAlgorithm<T>(parent, cost);
+
+        shortestPathLength = cost[target];
+        setShortestPath(parent);
+        timeTaken = double(elapsedNanoseconds(start)) / 1e9;
+    }
+
+
+    // Leaves the path empty if target can't be reached
+    void setShortestPath(StampedArray<int> &parent) {
+        if (shortestPathLength == unreachable) {
+            return;
+        }
+        // The parent is stored such from the destination the index points
+        // towards the previous node, so the path comes out backwards
+        int current = target;
+        while (current != source) {
+            shortestPath.push_back(current);
+            current = parent[current];
+            hopsOnShortestPath++;
+        }
+        shortestPath.push_back(current);
+        std::reverse(shortestPath.begin(), shortestPath.end());
+    }
+
+    inline int pathLength() const { return shortestPathLength; }
+
+    inline int hops() const { return hopsOnShortestPath; }
+
+    inline int settledCount() const { return nodesSettled; }
+
+    inline int pushedCount() const { return nodesPushed; }
+
+    inline int poppedCount() const { return nodesPopped; }
+
+    inline uint64_t relaxationCount() const { return relaxations; }
+
+    inline uint64_t scannedCount() const { return edgesScanned; }
+
+    inline const std::vector<int> &path() const { return shortestPath; }
+
+    // How many threads the searches that can use more than one get
+    void setThreadCount(unsigned threads) {
+        threadCount = threads;
+    }
+
+    // Bucket width for delta stepping, 0 picks one from the graph's weights
+    void setDelta(int width) {
+        delta = width;
+    }
+
+    // Searches that settle nodes also say how many, and how that compares to baseline's if there is one
+    void printData(const Search *baseline = nullptr) {
+        std::cout << "Shortest path: ";
+        printPath();
+        std::cout << std::endl
+                  << "Number of hops on shortest path: " << hopsOnShortestPath << std::endl
+                  << "Shortest path length: " << shortestPathLength << std::endl
+                  << "Nodes added: " << nodesPushed << std::endl
+                  << "Nodes popped: " << nodesPopped << std::endl;
+        if (nodesSettled > 0) {
+            std::cout << "Nodes settled: " << nodesSettled;
+            if (baseline && baseline->nodesSettled > 0) {
+                std::cout << " (" << 100.0 * nodesSettled / baseline->nodesSettled << "% of uniform cost search)";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "Time taken: " << timeTaken << std::endl;
+    }
+
+private:
+    void printPath() {
+        for (auto i : shortestPath) {
+            std::cout << i << " ";
+        }
+    }
+
+    //Due to someone defining these functions
+    int popNodeFromHeap(std::queue<int> &queueMode) {
+        return queueMode.front();
+    }
+
+    int popNodeFromHeap(std::stack<int> &stackMode) {
+        return stackMode.top();
+    }
+
+    int popNodeFromHeap(std::priority_queue<int> &priorityQueueMode) {
+        return priorityQueueMode.top();
+    }
+
+    // The queue and stack searches; the cost ordered queues have their own specialisations below the class
+    template<class T>
+    void xFirstSearchAlgorithm(StampedArray<int> &parent, StampedArray<int> &cost) {
+        int current; // Don't replace the space over and over
+        T heap;
+        heap.push(source);
+        while (!heap.empty()) {
+            current = popNodeFromHeap(heap);
+            heap.pop();
+            nodesPopped++;
+
+            if (current != target) {
+                edgesScanned += graph.lastEdge(current) - graph.firstEdge(current);
+                // Only real links are stored, so there are no zeros to skip
+                for (uint64_t edge = graph.firstEdge(current); edge < graph.lastEdge(current); edge++) {
+                    int neigh = graph.target(edge);
+                    if (cost[neigh] > cost[current] + graph.weight(edge)) {
+                        cost[neigh] = cost[current] + graph.weight(edge);
+                        parent[neigh] = current;
+                        heap.push(neigh);
+                        nodesPushed++;
+                        relaxations++;
+                    }
+                }
+            }
+        }
+    }
+
+    /*
+     * dijkstraSearch (see searchQueue.h) to target in the scratch arrays. Unlike the relax and re-push of the other
+     * searches it stops as soon as target's cost is final, rather than once the whole graph has stopped improving.
+     */
+    template<class Queue, class Estimate>
+    void uniformCostSearch(StampedArray<int> &parent, StampedArray<int> &cost, Queue &queue, Estimate estimate) {
+        DijkstraCounts counts = dijkstraSearch(graph, source, target, queue, cost, scratch->settled, estimate,
+                                               [&parent](int node, int from) { parent[node] = from; });
+        nodesPushed += counts.pushed;
+        nodesPopped += counts.popped;
+        nodesSettled += counts.settled;
+        relaxations += counts.relaxations;
+        edgesScanned += counts.scanned;
+    }
+
+    /*
+     * Settles the cheapest node of one side of a bidirectional search and relaxes its edges in edges (the graph, or
+     * its reverse for the side coming back from the target). Every edge that reaches a node the other side has a cost
+     * for is a way through, and best and meeting keep the cheapest one found so far.
+     */
+    void settleNext(IndexedHeap<> &queue, const Graph &edges, StampedArray<int> &cost,
+                    const StampedArray<int> &otherCost, StampedArray<char> &settled, StampedArray<int> &link,
+                    long long &best, int &meeting) {
+        int current = queue.pop();
+        nodesPopped++;
+        settled[current] = 1;
+        nodesSettled++;
+        edgesScanned += edges.lastEdge(current) - edges.firstEdge(current);
+        for (uint64_t edge = edges.firstEdge(current); edge < edges.lastEdge(current); edge++) {
+            int neigh = edges.target(edge);
+            int throughCurrent = cost[current] + edges.weight(edge);
+            if (!settled[neigh] && throughCurrent < cost[neigh]) {
+                cost[neigh] = throughCurrent;
+                link[neigh] = current;
+                queue.push(neigh, throughCurrent);
+                nodesPushed++;
+                relaxations++;
+            }
+            if (otherCost[neigh] != unreachable && (long long) throughCurrent + otherCost[neigh] < best) {
+                best = (long long) throughCurrent + otherCost[neigh];
+                meeting = neigh;
+            }
+        }
+    }
+
+    int source;
+    int target;
+    int nodeCount;
+
+    const Graph &graph;
+    const Graph *reverse;
+    const Landmarks *landmarks;
+    SearchScratch *scratch;
+    std::unique_ptr<SearchScratch> ownScratch;
+
+    std::vector<int> shortestPath;
+    int hopsOnShortestPath = 0;
+    int shortestPathLength = std::numeric_limits<short>::max();
+    unsigned threadCount = 1;
+    int delta = 0;
+
+    int nodesPushed = 0;
+    int nodesPopped = 0;
+    int nodesSettled = 0;
+    uint64_t relaxations = 0;
+    uint64_t edgesScanned = 0;
+    double timeTaken;
+};
+
+template<>
+inline void Search::xFirstSearchAlgorithm<BucketQueue>(StampedArray<int> &parent, StampedArray<int> &cost) {
+    uniformCostSearch(parent, cost, scratch->buckets, [](int) { return 0; });
+}
+
+template<>
+inline void Search::xFirstSearchAlgorithm<IndexedHeap<>>(StampedArray<int> &parent, StampedArray<int> &cost) {
+    uniformCostSearch(parent, cost, scratch->forward, [](int) { return 0; });
+}
+
+/*
+ * Forward from source and backward from target, always moving the side with less queued. Once the two cheapest queued
+ * costs add up to at least the best way through found so far, nothing left can beat it. Each side only gets about
+ * half way, which on a graph that spreads out evenly is far fewer nodes than one search going all the way.
+ */
+template<>
+inline void Search::xFirstSearchAlgorithm<Bidirectional>(StampedArray<int> &parent, StampedArray<int> &cost) {
+    StampedArray<int> &backCost = scratch->backCost;
+    StampedArray<int> &next = scratch->next;
+    StampedArray<char> &settled = scratch->settled;
+    StampedArray<char> &backSettled = scratch->backSettled;
+    IndexedHeap<> &forward = scratch->forward;
+    IndexedHeap<> &backward = scratch->backward;
+    backCost[target] = 0;
+    forward.push(source, 0);
+    backward.push(target, 0);
+    nodesPushed += 2;
+    long long best = source == target ? 0 : std::numeric_limits<long long>::max();
+    int meeting = source;
+
+    while (!forward.empty() && !backward.empty() &&
+           (long long) cost[forward.top()] + backCost[backward.top()] < best) {
+        if (forward.size() <= backward.size()) {
+            settleNext(forward, graph, cost, backCost, settled, parent, best, meeting);
+        } else {
+            settleNext(backward, *reverse, backCost, cost, backSettled, next, best, meeting);
+        }
+    }
+
+    // The backward side's links point towards target, turning them around finishes the path through meeting
+    if (best != std::numeric_limits<long long>::max()) {
+        for (int node = meeting; node != target; node = next[node]) {
+            parent[next[node]] = node;
+        }
+        cost[target] = int(best);
+    }
+}
+
+template<>
+inline void Search::xFirstSearchAlgorithm<LandmarkAStar>(StampedArray<int> &parent, StampedArray<int> &cost) {
+    uniformCostSearch(parent, cost, scratch->forward, [this](int node) { return landmarks->estimate(node, target); });
+}
+
+/*
+ * The path with the fewest edges rather than the lowest cost, so its length is what those edges add up to and can be
+ * more than the shortest. Nodes added and popped are the nodes that joined a frontier and that one was expanded from.
+ */
+template<>
+inline void Search::xFirstSearchAlgorithm<FewestHops>(StampedArray<int> &parent, StampedArray<int> &cost) {
+    BfsTree tree = levelSynchronousBfs(graph, reverse, source, target, threadCount);
+    nodesPushed += int(tree.discovered);
+    nodesPopped += int(tree.expanded);
+    // Every node but source was reached over exactly one edge
+    relaxations += tree.discovered - 1;
+    edgesScanned += tree.scanned;
+    if (tree.parent[target] == -1) {
+        return;
+    }
+    int length = 0;
+    for (int node = target; node != source; node = tree.parent[node]) {
+        parent[node] = tree.parent[node];
+        int lightest = unreachable;
+        for (uint64_t edge = graph.firstEdge(parent[node]); edge < graph.lastEdge(parent[node]); edge++) {
+            if (graph.target(edge) == node) {
+                lightest = std::min(lightest, graph.weight(edge));
+            }
+        }
+        length += lightest;
+    }
+    cost[target] = length;
+}
+
+template<>
+inline void Search::xFirstSearchAlgorithm<DeltaStepping>(StampedArray<int> &parent, StampedArray<int> &cost) {
+    ShortestPathTree tree = deltaStepping(graph, source, target, delta > 0 ? delta : defaultDelta(graph), threadCount);
+    nodesPushed += int(tree.queued);
+    nodesPopped += int(tree.relaxed);
+    nodesSettled += int(tree.settled);
+    relaxations += tree.queued - 1;
+    edgesScanned += tree.scanned;
+    for (int node = 0; node < nodeCount; node++) {
+        if (tree.distance[node] != unreachable) {
+            cost[node] = tree.distance[node];
+            parent[node] = tree.parent[node];
+        }
+    }
+}
+
+#endif //PROJECT4_SEARCH_H
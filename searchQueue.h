@@ -0,0 +1,251 @@
+#ifndef PROJECT4_SEARCHQUEUE_H
+#define PROJECT4_SEARCHQUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include "graph.h"
+
+/*
+ * Dial's bucket queue: one bucket of nodes per cost, in a ring of maxWeight + 1 buckets. Dijkstra only ever pushes
+ * costs between the one it last popped and that plus the heaviest edge, so they all fit in the ring at once, and
+ * popping is walking forward to the next bucket with anything in it. That's O(1) per push and pop against the
+ * O(log n) of a heap, which pays off when weights are small integers like gengraph's 1 to 5.
+ *
+ * A node isn't moved when it gets cheaper, it's just pushed again, so the search has to skip nodes it has already
+ * settled when they come out a second time. Costs can't be negative.
+ */
+class BucketQueue {
+public:
+    explicit BucketQueue(int maxWeight) : buckets(size_t(maxWeight) + 1) {}
+
+    void push(int node, int cost) {
+        buckets[size_t(cost) % buckets.size()].push_back(node);
+        count++;
+    }
+
+    inline bool empty() const { return count == 0; }
+
+    /*
+     * Drops whatever is left, which is the nodes an early exit didn't get to. They're all within a ring's length of at,
+     * so this walks forward from there only until they've all gone, and an empty queue costs nothing to clear.
+     */
+    void clear() {
+        for (size_t bucket = at; count > 0; bucket = bucket + 1 == buckets.size() ? 0 : bucket + 1) {
+            count -= buckets[bucket].size();
+            buckets[bucket].clear();
+        }
+        at = 0;
+    }
+
+    // One of the cheapest nodes, costs come out in increasing order
+    int pop() {
+        while (buckets[at].empty()) {
+            at = at + 1 == buckets.size() ? 0 : at + 1;
+        }
+        int node = buckets[at].back();
+        buckets[at].pop_back();
+        count--;
+        return node;
+    }
+
+private:
+    std::vector<std::vector<int>> buckets;
+    size_t at = 0;
+    size_t count = 0;
+};
+
+/*
+ * Binary heaps are a special case of this with Arity 2; a wider node makes the tree shallower, so pushes (and the
+ * decreases that dominate Dijkstra) move a node up fewer levels, while a pop looks at more children per level that
+ * sit next to each other in memory. position remembers where each node is in the heap, so a node that gets cheaper
+ * is moved up in place instead of being pushed again, and every node is in the heap at most once. Works for any
+ * weights that fit in an int.
+ */
+template<int Arity = 4>
+class IndexedHeap {
+public:
+    explicit IndexedHeap(int nodeCount) : position(size_t(nodeCount), absent), keys(size_t(nodeCount)) {}
+
+    // Adds node with cost, or lowers its cost if it's already in the heap and cost is lower
+    void push(int node, int cost) {
+        if (position[node] == absent) {
+            position[node] = uint32_t(heap.size());
+            heap.push_back(node);
+        } else if (cost >= keys[node]) {
+            return;
+        }
+        keys[node] = cost;
+        siftUp(position[node]);
+    }
+
+    inline bool empty() const { return heap.empty(); }
+
+    inline size_t size() const { return heap.size(); }
+
+    // The cheapest node, left in the heap
+    inline int top() const { return heap.front(); }
+
+    // Drops whatever is left, in time proportional to that rather than to the node count
+    void clear() {
+        for (int node : heap) {
+            position[node] = absent;
+        }
+        heap.clear();
+    }
+
+    // The cheapest node
+    int pop() {
+        int node = heap.front();
+        position[node] = absent;
+        int last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0] = last;
+            position[last] = 0;
+            siftDown(0);
+        }
+        return node;
+    }
+
+private:
+    static const uint32_t absent = UINT32_MAX;
+
+    void siftUp(uint32_t slot) {
+        int node = heap[slot];
+        while (slot > 0) {
+            uint32_t parent = (slot - 1) / Arity;
+            if (keys[heap[parent]] <= keys[node]) {
+                break;
+            }
+            place(heap[parent], slot);
+            slot = parent;
+        }
+        place(node, slot);
+    }
+
+    void siftDown(uint32_t slot) {
+        int node = heap[slot];
+        size_t size = heap.size();
+        while (true) {
+            size_t first = size_t(slot) * Arity + 1;
+            if (first >= size) {
+                break;
+            }
+            size_t last = first + Arity < size ? first + Arity : size;
+            size_t cheapest = first;
+            for (size_t child = first + 1; child < last; child++) {
+                if (keys[heap[child]] < keys[heap[cheapest]]) {
+                    cheapest = child;
+                }
+            }
+            if (keys[heap[cheapest]] >= keys[node]) {
+                break;
+            }
+            place(heap[cheapest], uint32_t(slot));
+            slot = uint32_t(cheapest);
+        }
+        place(node, slot);
+    }
+
+    inline void place(int node, uint32_t slot) {
+        heap[slot] = node;
+        position[node] = slot;
+    }
+
+    std::vector<int> heap;
+    std::vector<uint32_t> position;
+    std::vector<int> keys;
+};
+
+template<int Arity>
+const uint32_t IndexedHeap<Arity>::absent;
+
+// What a dijkstraSearch did, counted the way Search counts it
+struct DijkstraCounts {
+    int pushed = 0;
+    int popped = 0;
+    int settled = 0;
+    uint64_t relaxations = 0;
+    uint64_t scanned = 0;
+};
+
+/*
+ * Dijkstra: nodes come out of queue cheapest first, so the first time a node comes out its cost is final and it's
+ * never expanded again, and the search is over as soon as target comes out (or once everything reachable has, if
+ * target is -1). Weights can't be negative.
+ *
+ * Nodes are queued by their cost plus estimate(node), a lower bound on what's left to the target. Plain Dijkstra
+ * estimates 0 everywhere; anything higher is A*, which leaves the nodes leading away from the target for last.
+ *
+ * cost and settled are indexed by node and have to start out unreachable and 0 everywhere, and queue empty, which it
+ * is again afterwards unless target stopped the search early. onRelax(node, from) is called every time node's cost is
+ * lowered through from, for keeping parents or first hops.
+ */
+template<class Queue, class Costs, class Flags, class Estimate, class OnRelax>
+DijkstraCounts dijkstraSearch(const Graph &graph, int source, int target, Queue &queue, Costs &cost, Flags &settled,
+                              Estimate estimate, OnRelax onRelax) {
+    DijkstraCounts counts;
+    cost[source] = 0;
+    queue.push(source, estimate(source));
+    counts.pushed++;
+    while (!queue.empty()) {
+        int current = queue.pop();
+        counts.popped++;
+        // A bucket queue leaves the older, dearer copies of a node behind
+        if (settled[current]) {
+            continue;
+        }
+        settled[current] = 1;
+        counts.settled++;
+        if (current == target) {
+            break;
+        }
+        counts.scanned += graph.lastEdge(current) - graph.firstEdge(current);
+        for (uint64_t edge = graph.firstEdge(current); edge < graph.lastEdge(current); edge++) {
+            int neigh = graph.target(edge);
+            int throughCurrent = cost[current] + graph.weight(edge);
+            if (!settled[neigh] && throughCurrent < cost[neigh]) {
+                cost[neigh] = throughCurrent;
+                onRelax(neigh, current);
+                queue.push(neigh, throughCurrent + estimate(neigh));
+                counts.pushed++;
+                counts.relaxations++;
+            }
+        }
+    }
+    return counts;
+}
+
+/*
+ * Dijkstra from source to every node. distance[node] ends up the cost of the cheapest path there, or unreachable, and
+ * firstHop[node], when it's asked for, the node that path goes to right after source (-1 for source itself and nodes
+ * that can't be reached). queue has to be empty, and is again afterwards.
+ */
+template<class Queue>
+void shortestFrom(const Graph &graph, int source, Queue &queue, std::vector<int> &distance,
+                  std::vector<char> &settled, std::vector<int> *firstHop = nullptr) {
+    distance.assign(size_t(graph.nodeCount()), unreachable);
+    settled.assign(size_t(graph.nodeCount()), 0);
+    if (firstHop) {
+        firstHop->assign(size_t(graph.nodeCount()), -1);
+    }
+    dijkstraSearch(graph, source, -1, queue, distance, settled, [](int) { return 0; }, [&](int node, int from) {
+        if (firstHop) {
+            (*firstHop)[node] = from == source ? node : (*firstHop)[from];
+        }
+    });
+}
+
+// Every node's distance from source, unreachable for the ones that can't be reached
+inline std::vector<int> distancesFrom(const Graph &graph, int source) {
+    std::vector<int> distance;
+    std::vector<char> settled;
+    IndexedHeap<> queue(graph.nodeCount());
+    shortestFrom(graph, source, queue, distance, settled);
+    return distance;
+}
+
+// Heavier weights than this would make for a ring of mostly empty buckets, the heap is used instead
+const int bucketQueueWeightLimit = 1 << 16;
+
+#endif //PROJECT4_SEARCHQUEUE_H
@@ -0,0 +1,118 @@
+#ifndef PROJECT4_SEARCHSCRATCH_H
+#define PROJECT4_SEARCHSCRATCH_H
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "graph.h"
+#include "searchQueue.h"
+
+/*
+ * An array that goes back to all initial in O(1): every element carries the version it was last written in, and
+ * reset() just starts a new version, so an element from an older one reads as initial. A search only touches the
+ * nodes it reaches, which for a point to point query is often a small part of the graph, and this way that's all it
+ * pays for instead of filling node count sized arrays before every query.
+ */
+template<class T>
+class StampedArray {
+public:
+    StampedArray(size_t size, T initial) : values(size), stamps(size, 0), initial(initial) {}
+
+    void reset() {
+        // Once in four billion resets the stamps wrap around and really have to be cleared
+        if (++version == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            version = 1;
+        }
+    }
+
+    inline T &operator[](size_t i) {
+        if (stamps[i] != version) {
+            stamps[i] = version;
+            values[i] = initial;
+        }
+        return values[i];
+    }
+
+    inline T operator[](size_t i) const {
+        return stamps[i] == version ? values[i] : initial;
+    }
+
+private:
+    std::vector<T> values;
+    std::vector<uint32_t> stamps;
+    T initial;
+    uint32_t version = 1;
+};
+
+/*
+ * Everything a Search needs that's as big as the graph: costs and links for both directions, what's been settled, and
+ * the queues. One of these is reused for query after query, see reset.
+ */
+struct SearchScratch {
+    explicit SearchScratch(const Graph &graph)
+            : parent(size_t(graph.nodeCount()), -1), cost(size_t(graph.nodeCount()), unreachable),
+              backCost(size_t(graph.nodeCount()), unreachable), next(size_t(graph.nodeCount()), -1),
+              settled(size_t(graph.nodeCount()), 0), backSettled(size_t(graph.nodeCount()), 0),
+              buckets(std::min(graph.weightBound(), bucketQueueWeightLimit)), forward(graph.nodeCount()),
+              backward(graph.nodeCount()) {}
+
+    // Back to how it was made, in time proportional to what the last search left in the queues
+    void reset() {
+        parent.reset();
+        cost.reset();
+        backCost.reset();
+        next.reset();
+        settled.reset();
+        backSettled.reset();
+        buckets.clear();
+        forward.clear();
+        backward.clear();
+    }
+
+    StampedArray<int> parent;
+    StampedArray<int> cost;
+    // The backward half of a bidirectional search, where next points towards the target
+    StampedArray<int> backCost;
+    StampedArray<int> next;
+    StampedArray<char> settled;
+    StampedArray<char> backSettled;
+    BucketQueue buckets;
+    IndexedHeap<> forward;
+    IndexedHeap<> backward;
+};
+
+/*
+ * Hands out scratch for a graph to whichever worker needs one and takes it back afterwards. Only as many are ever made
+ * as are in use at once, which is one per worker thread.
+ */
+class ScratchPool {
+public:
+    explicit ScratchPool(const Graph &graph) : graph(graph) {}
+
+    std::unique_ptr<SearchScratch> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!spare.empty()) {
+                std::unique_ptr<SearchScratch> scratch = std::move(spare.back());
+                spare.pop_back();
+                return scratch;
+            }
+        }
+        return std::unique_ptr<SearchScratch>(new SearchScratch(graph));
+    }
+
+    void release(std::unique_ptr<SearchScratch> scratch) {
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(std::move(scratch));
+    }
+
+private:
+    const Graph &graph;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<SearchScratch>> spare;
+};
+
+#endif //PROJECT4_SEARCHSCRATCH_H
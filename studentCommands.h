@@ -0,0 +1,435 @@
+#ifndef PROJECT4_STUDENTCOMMANDS_H
+#define PROJECT4_STUDENTCOMMANDS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include "studentData.h"
+#include "studentIndex.h"
+#include "gradeQuery.h"
+#include "gradeStats.h"
+#include "taskStats.h"
+#include "resultWriter.h"
+#include "parallel.h"
+
+/*
+ * Which part of a listing to print: skip offset rows, print at most limit. fromBottom walks the index from the other
+ * end, so "biology bottom 10" is the ten lowest biology grades.
+ */
+struct Page {
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
+    bool fromBottom = false;
+};
+
+// Reads any "limit n", "offset m", "top k" or "bottom k" left in args. False if there's anything else
+inline bool readPage(std::istream &args, Page &page) {
+    std::string option;
+    long long value;
+    while (args >> option) {
+        std::transform(option.begin(), option.end(), option.begin(), ::tolower);
+        if (!(args >> value) || value < 0) {
+            return false;
+        }
+        if (option == "limit") {
+            page.limit = size_t(value);
+        } else if (option == "offset") {
+            page.offset = size_t(value);
+        } else if (option == "top" || option == "bottom") {
+            page.limit = size_t(value);
+            page.fromBottom = option == "bottom";
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void printStudent(ResultWriter &out, const StudentStore &studentData, StudentId student) {
+    out.student(studentData, student);
+}
+
+// Prints the page of the first count entries of toPrint
+inline void printRange(ResultWriter &out, const StudentStore &studentData, const std::vector<StudentId> &toPrint,
+                       size_t count, const Page &page) {
+    out.beginListing();
+    size_t first = std::min(page.offset, count);
+    size_t last = first + std::min(page.limit, count - first);
+    for (size_t i = first; i < last; i++) {
+        out.student(studentData, page.fromBottom ? toPrint[count - 1 - i] : toPrint[i]);
+    }
+}
+
+inline void printData(ResultWriter &out, const StudentStore &studentData, const std::vector<StudentId> &toPrint,
+                      const Page &page = Page()) {
+    printRange(out, studentData, toPrint, toPrint.size(), page);
+}
+
+class compareGrade {
+public:
+    explicit compareGrade(const std::vector<int> &column) : column(column.data()) {}
+
+    inline bool operator()(StudentId i, int const &value) const {
+        return column[i] > value;
+    }
+
+private:
+    const int *column;
+};
+
+inline int countStudentsWithGradeAbove(const StudentStore &studentData, const std::vector<StudentId> &toPrint,
+                                       int value, int index) {
+    compareGrade comp{studentData.column(index)};
+    auto iter = std::lower_bound(toPrint.begin(), toPrint.end(), value, comp);
+    return int(std::distance(toPrint.begin(), iter));
+}
+
+// Everyone with a grade above value is at the front of the index, so the cut off is found with a binary search
+inline void printDataUntil(ResultWriter &out, const StudentStore &studentData, const std::vector<StudentId> &toPrint,
+                           int value, int index, const Page &page = Page()) {
+    size_t count = size_t(countStudentsWithGradeAbove(studentData, toPrint, value, index));
+    printRange(out, studentData, toPrint, count, page);
+}
+
+/*
+ * The Task1 command language, separate from where the commands come from so the REPL and batch mode can share it.
+ * Commands never change anything, they only take the store lock shared while they run, so any number of them can run
+ * at once.
+ */
+class StudentCommands {
+public:
+    // Every command's latency and output goes to stats, if there is one
+    StudentCommands(const StudentStore &studentData, const LazyIndexes &sortedIndexes,
+                    const GradeQueryIndex &queryIndex, std::shared_timed_mutex &storeMutex, TaskStats *stats = nullptr)
+            : studentData(studentData), sortedIndexes(sortedIndexes), queryIndex(queryIndex),
+              storeMutex(storeMutex), stats(stats) {}
+
+    /*
+     * Runs one line, writing anything it prints to out. Commands:
+     *      biology, maths, chemistry, physics, total, names [page]    list an index
+     *      <subject>until grade [page]                                list everyone above grade
+     *      <subject>count grade                                       count everyone above grade
+     *      subject op grade [and subject op grade]...                 count everyone matching all of them
+     *      find name
+     *      prefix start [page]                                        list everyone whose name starts with start
+     *      range from to [page]                                       list everyone from name from to name to
+     *      summary [subject]                                          count, mean, stddev, min, max and median
+     *      percentile subject p [p]...                                p from 0 to 100, 50 is the median
+     *      histogram subject [width]                                  how many students in each width grades
+     *      format table|csv|tsv                                       for this writer from now on
+     *      stats                                                      counters, timings and memory use
+     * where page is any of limit n, offset m, top k, bottom k. Returns false once the line is exit.
+     */
+    bool execute(const std::string &line, ResultWriter &out) const {
+        // Started before the lock so a command held up by --follow's writer is timed as slow as it really was
+        auto start = std::chrono::steady_clock::now();
+        std::shared_lock<std::shared_timed_mutex> readLock(storeMutex);
+        uint64_t lockWait = elapsedNanoseconds(start);
+        size_t writtenBefore = out.written();
+        CommandKind kind = CommandKind::other;
+        bool timed = true;
+        bool keepGoing = run(line, out, kind, timed);
+        if (stats && timed) {
+            stats->recordCommand(kind, elapsedNanoseconds(start), lockWait, out.written() - writtenBefore);
+        }
+        return keepGoing;
+    }
+
+private:
+    bool run(const std::string &line, ResultWriter &out, CommandKind &kind, bool &timed) const {
+        // A subject followed by a comparison is a compound count query like "biology>80 and maths>=70"
+        if (isGradeQuery(line)) {
+            kind = CommandKind::query;
+            try {
+                out << queryIndex.countMatching(parseGradeQuery(line)) << " students match that\n";
+            } catch (std::invalid_argument &error) {
+                out << "Sorry, that query didn't make sense: " << error.what() << '\n';
+            }
+            return true;
+        }
+
+        std::istringstream args(line);
+        std::string instruction;
+        if (!(args >> instruction)) {
+            return true;
+        }
+        for (int i = 0; i < 255 && instruction[i] != '\0'; i++) {
+            instruction[i] = char(::tolower(instruction[i]));
+        }
+
+        int subject = subjectFromCommandName(instruction);
+        int instructionNum;
+        Page page;
+        if (subject >= 0 || instruction == "names") {
+            kind = CommandKind::listing;
+            if (!readPage(args, page)) {
+                return badOptions(out, instruction);
+            }
+            printListing(out, subject >= 0 ? subject : namesIndex, page);
+        } else if ((subject = commandSubject(instruction, "until")) >= 0) {
+            kind = CommandKind::until;
+            if (!(args >> instructionNum) || !readPage(args, page)) {
+                return badOptions(out, instruction);
+            }
+            printUntil(out, subject, instructionNum, page);
+        } else if ((subject = commandSubject(instruction, "count")) >= 0) {
+            kind = CommandKind::count;
+            if (!(args >> instructionNum)) {
+                return badOptions(out, instruction);
+            }
+            out << queryIndex.countAbove(subject, instructionNum) << " students have a grade above that\n";
+        } else if (instruction == "find") {
+            kind = CommandKind::find;
+            args >> instruction;
+            StudentId student = sortedIndexes.names().find(NameView(instruction));
+            if (student == StudentStore::notFound) {
+                // Unknown names print as a student with no grades, without adding one
+                int noGrades[5]{};
+                out.student(NameView(instruction), noGrades);
+            } else {
+                printStudent(out, studentData, student);
+            }
+        } else if (instruction == "prefix" || instruction == "range") {
+            kind = CommandKind::nameSearch;
+            std::string from;
+            std::string to;
+            if (!(args >> from) || (instruction == "range" && !(args >> to)) || !readPage(args, page)) {
+                return badOptions(out, instruction);
+            }
+            const SortedNameIndex &names = sortedIndexes.names();
+            auto positions = instruction == "prefix" ? names.prefix(NameView(from))
+                                                     : names.range(NameView(from), NameView(to));
+            printNames(out, names, positions.first, positions.second, page);
+        } else if (instruction == "summary") {
+            kind = CommandKind::statistics;
+            std::string name;
+            subject = args >> name ? subjectFromCommandName(name) : -1;
+            if (!name.empty() && subject < 0) {
+                return badOptions(out, instruction);
+            }
+            printSummaries(out, subject);
+        } else if (instruction == "percentile") {
+            kind = CommandKind::statistics;
+            std::string name;
+            std::vector<double> ps;
+            double p;
+            args >> name;
+            while (args >> p) {
+                ps.push_back(p);
+            }
+            if ((subject = subjectFromCommandName(name)) < 0 || ps.empty() || !args.eof()) {
+                return badOptions(out, instruction);
+            }
+            printPercentiles(out, subject, ps);
+        } else if (instruction == "histogram") {
+            kind = CommandKind::statistics;
+            std::string name;
+            std::string widthText;
+            args >> name >> widthText;
+            int width = widthText.empty() ? 10 : std::atoi(widthText.c_str());
+            if ((subject = subjectFromCommandName(name)) < 0 || width <= 0) {
+                return badOptions(out, instruction);
+            }
+            printHistogram(out, subject, width);
+        } else if (instruction == "format") {
+            std::string name;
+            args >> name;
+            OutputFormat format;
+            if (formatFromName(name, format)) {
+                out.setFormat(format);
+            } else {
+                out << "Sorry, the formats are table, csv and tsv\n";
+            }
+        } else if (instruction == "stats") {
+            // Looking at the stats shouldn't change them
+            timed = false;
+            if (stats) {
+                stats->print(out, studentData, sortedIndexes, queryIndex);
+            } else {
+                out << "Sorry, stats aren't being kept\n";
+            }
+        } else if (instruction == "exit") {
+            return false;
+        } else {
+            out << "Sorry, that's an unrecognised command\n";
+            out << "you entered: " << instruction << '\n';
+        }
+        return true;
+    }
+
+    // "mathsuntil" with suffix "until" is 1, -1 if instruction isn't a subject followed by suffix
+    static int commandSubject(const std::string &instruction, const std::string &suffix) {
+        if (instruction.size() <= suffix.size() ||
+            instruction.compare(instruction.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            return -1;
+        }
+        return subjectFromCommandName(instruction.substr(0, instruction.size() - suffix.size()));
+    }
+
+    /*
+     * A short page of an index nobody has asked for yet is picked straight out of the store with topStudents rather
+     * than building the whole index for it. Anything longer, or an index that's there already, reads the index.
+     */
+    bool worthSelecting(int index, const Page &page) const {
+        size_t studentCount = studentData.size();
+        return !sortedIndexes.isBuilt(index) && page.offset <= studentCount && page.limit <= studentCount &&
+               (page.offset + page.limit) * selectFraction <= studentCount;
+    }
+
+    void printListing(ResultWriter &out, int index, const Page &page) const {
+        if (worthSelecting(index, page)) {
+            Page selectedPage = page;
+            selectedPage.fromBottom = false;
+            printData(out, studentData, topStudents(studentData, index, page.offset + page.limit, page.fromBottom),
+                      selectedPage);
+        } else {
+            printData(out, studentData, sortedIndexes.get(index), page);
+        }
+    }
+
+    // Everyone above value is at the front of the index, and the histogram says how many of them there are
+    void printUntil(ResultWriter &out, int subject, int value, const Page &page) const {
+        size_t count = queryIndex.countAbove(subject, value);
+        if (!page.fromBottom && worthSelecting(subject, page)) {
+            std::vector<StudentId> top = topStudents(studentData, subject, std::min(count, page.offset + page.limit),
+                                                     false);
+            printRange(out, studentData, top, top.size(), page);
+        } else {
+            printRange(out, studentData, sortedIndexes.get(subject), count, page);
+        }
+    }
+
+    // The page of positions [first, last) of names
+    void printNames(ResultWriter &out, const SortedNameIndex &names, size_t first, size_t last,
+                    const Page &page) const {
+        out.beginListing();
+        size_t count = last - first;
+        size_t from = std::min(page.offset, count);
+        size_t to = from + std::min(page.limit, count - from);
+        for (size_t i = from; i < to; i++) {
+            out.student(studentData, names.id(page.fromBottom ? last - 1 - i : first + i));
+        }
+    }
+
+    // Every subject (and Total) when subject is -1
+    void printSummaries(ResultWriter &out, int subject) const {
+        char separator = out.format() == OutputFormat::csv ? ',' : '\t';
+        if (out.format() != OutputFormat::table) {
+            out << "subject" << separator << "count" << separator << "mean" << separator << "stddev" << separator
+                << "min" << separator << "max" << separator << "median\n";
+        }
+        for (int i = subject < 0 ? 0 : subject; i < (subject < 0 ? 5 : subject + 1); i++) {
+            ColumnSummary summary = summarise(studentData.column(i));
+            double median = percentile(studentData.column(i), sortedIndexes.get(i), 50);
+            if (out.format() == OutputFormat::table) {
+                out << subjectNames[i] << ": " << summary.count << " students | mean: " << summary.mean
+                    << " | stddev: " << summary.stddev << " | min: " << summary.minimum << " | max: "
+                    << summary.maximum << " | median: " << median << '\n';
+            } else {
+                out << subjectNames[i] << separator << summary.count << separator << summary.mean << separator
+                    << summary.stddev << separator << summary.minimum << separator << summary.maximum << separator
+                    << median << '\n';
+            }
+        }
+    }
+
+    void printPercentiles(ResultWriter &out, int subject, const std::vector<double> &ps) const {
+        char separator = out.format() == OutputFormat::csv ? ',' : '\t';
+        if (out.format() != OutputFormat::table) {
+            out << "percentile" << separator << subjectNames[subject] << '\n';
+        }
+        const std::vector<StudentId> &sorted = sortedIndexes.get(subject);
+        for (double p : ps) {
+            double grade = percentile(studentData.column(subject), sorted, p);
+            if (out.format() == OutputFormat::table) {
+                out << "Percentile " << p << " of " << subjectNames[subject] << ": " << grade << '\n';
+            } else {
+                out << p << separator << grade << '\n';
+            }
+        }
+    }
+
+    // Buckets start at multiples of width, the counts come from the differences of the cumulative histogram
+    void printHistogram(ResultWriter &out, int subject, int width) const {
+        char separator = out.format() == OutputFormat::csv ? ',' : '\t';
+        if (out.format() != OutputFormat::table) {
+            out << "from" << separator << "to" << separator << "students\n";
+        }
+        const GradeHistogram &histogram = queryIndex.histogram(subject);
+        if (studentData.size() == 0) {
+            return;
+        }
+        long long lowest = histogram.lowestPresent();
+        long long first = lowest - ((lowest % width) + width) % width;
+        for (long long from = first; from <= histogram.highest(); from += width) {
+            long long to = from + width - 1;
+            StudentId students = histogram.countAtLeast(int(from)) -
+                                 (to >= histogram.highest() ? 0 : histogram.countAtLeast(int(to + 1)));
+            if (out.format() == OutputFormat::table) {
+                out << subjectNames[subject] << ' ' << from << '-' << to << ": " << students << '\n';
+            } else {
+                out << from << separator << to << separator << students << '\n';
+            }
+        }
+    }
+
+    static bool badOptions(ResultWriter &out, const std::string &instruction) {
+        out << "Sorry, I didn't understand what came after " << instruction << '\n';
+        return true;
+    }
+
+    // Pages up to 1/selectFraction of the students are selected rather than sorted for
+    static constexpr size_t selectFraction = 16;
+
+    const StudentStore &studentData;
+    const LazyIndexes &sortedIndexes;
+    const GradeQueryIndex &queryIndex;
+    std::shared_timed_mutex &storeMutex;
+    TaskStats *stats;
+};
+
+/*
+ * Runs a whole file of commands on threadCount threads against the shared indexes and writes each command's output to
+ * sink in the order the commands were given. The format a format line picks is worked out up front, as it applies to
+ * every command after it, but the line itself runs in its place like any other, so a bad one's complaint comes out
+ * where it was given and the format stays as it was. The batch stops at the first exit.
+ */
+inline void runBatch(const StudentCommands &commands, std::istream &input, std::ostream &sink, unsigned threadCount) {
+    std::vector<std::string> lines;
+    std::vector<OutputFormat> formats;
+    OutputFormat format = OutputFormat::table;
+    std::string line;
+    while (std::getline(input, line)) {
+        std::istringstream args(line);
+        std::string instruction;
+        args >> instruction;
+        std::transform(instruction.begin(), instruction.end(), instruction.begin(), ::tolower);
+        if (instruction == "exit") {
+            break;
+        }
+        lines.push_back(line);
+        formats.push_back(format);
+        if (instruction == "format") {
+            std::string name;
+            args >> name;
+            formatFromName(name, format);
+        }
+    }
+
+    orderedParallelFor<std::string>(lines.size(), threadCount, size_t(threadCount) * 16, [&](size_t i) {
+        ResultWriter out;
+        out.setFormat(formats[i]);
+        commands.execute(lines[i], out);
+        return out.take();
+    }, [&sink](size_t, const std::string &output) {
+        sink.write(output.data(), std::streamsize(output.size()));
+    });
+    sink.flush();
+}
+
+#endif //PROJECT4_STUDENTCOMMANDS_H
@@ -0,0 +1,466 @@
+#ifndef PROJECT4_STUDENTDATA_H
+#define PROJECT4_STUDENTDATA_H
+
+#include <string>
+#include <array>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <unordered_map>
+#include "mappedFile.h"
+#include "parallel.h"
+
+/*
+ * A name that lives somewhere else, either inside the mapped input file or inside a NameArena. Keying the main table
+ * on these instead of std::string means loading a line never touches the heap; the only allocation left is the hash
+ * node itself, which happens once per student rather than once per line.
+ */
+struct NameView {
+    NameView() = default;
+
+    NameView(const char *data, uint32_t length) : data(data), length(length) {}
+
+    // Only for lookups, the view must not outlive the string
+    explicit NameView(const std::string &name) : data(name.data()), length(uint32_t(name.size())) {}
+
+    std::string str() const {
+        return std::string(data, length);
+    }
+
+    const char *data = nullptr;
+    uint32_t length = 0;
+};
+
+inline bool operator==(const NameView &i, const NameView &j) {
+    return i.length == j.length && std::memcmp(i.data, j.data, i.length) == 0;
+}
+
+inline bool operator!=(const NameView &i, const NameView &j) {
+    return !(i == j);
+}
+
+// Same ordering as std::string so the names index doesn't change
+inline bool operator<(const NameView &i, const NameView &j) {
+    int result = std::memcmp(i.data, j.data, std::min(i.length, j.length));
+    return result < 0 || (result == 0 && i.length < j.length);
+}
+
+inline std::ostream &operator<<(std::ostream &os, const NameView &name) {
+    // Respect std::setw/std::left the same way printing a std::string would
+    std::streamsize padding = os.width() > std::streamsize(name.length) ? os.width() - name.length : 0;
+    bool leftAligned = (os.flags() & std::ios::adjustfield) == std::ios::left;
+    if (!leftAligned) {
+        for (std::streamsize i = 0; i < padding; i++) os.put(os.fill());
+    }
+    os.write(name.data, name.length);
+    if (leftAligned) {
+        for (std::streamsize i = 0; i < padding; i++) os.put(os.fill());
+    }
+    os.width(0);
+    return os;
+}
+
+class NameViewHash {
+public:
+    // FNV-1a, names are short so anything fancier doesn't pay for itself
+    inline size_t operator()(const NameView &name) const {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t i = 0; i < name.length; i++) {
+            hash ^= uint8_t(name.data[i]);
+            hash *= 1099511628211ull;
+        }
+        return size_t(hash);
+    }
+};
+
+/*
+ * Owns the characters of names that didn't come from a mapping. Names are copied into large blocks back to back, so
+ * interning is a memcpy and views stay valid for as long as the arena does (blocks never move).
+ */
+class NameArena {
+public:
+    NameView intern(const char *text, size_t length) {
+        if (used + length > capacity) {
+            capacity = length > blockSize ? length : blockSize;
+            blocks.emplace_back(new char[capacity]);
+            used = 0;
+        }
+        char *destination = blocks.back().get() + used;
+        std::memcpy(destination, text, length);
+        used += length;
+        return NameView(destination, uint32_t(length));
+    }
+
+    NameView intern(const std::string &text) {
+        return intern(text.data(), text.size());
+    }
+
+    inline size_t memoryBytes() const {
+        return blocks.empty() ? 0 : (blocks.size() - 1) * blockSize + capacity;
+    }
+
+private:
+    static constexpr size_t blockSize = 1 << 16;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t used = 0;
+    size_t capacity = 0;
+};
+
+typedef uint32_t StudentId;
+
+// How full a hash table is: how many buckets have anything in them and how long the longest chain is
+struct HashTableStats {
+    size_t entries = 0;
+    size_t buckets = 0;
+    size_t usedBuckets = 0;
+    size_t longestChain = 0;
+    double loadFactor = 0;
+};
+
+/*
+ * Column store for the student table. Students get dense ids in the order they are first seen and every subject is one
+ * contiguous column indexed by that id, so sorting or scanning a subject walks an int array instead of chasing hash
+ * nodes. The hash map is only used to turn a name into an id, and only exists once something calls find or findOrAdd:
+ * loading in bulk (appendAll, assign) leaves it to be built on the first lookup (or by buildIdMap), so a store that is
+ * only ever searched through a SortedNameIndex never pays for the hash nodes. The map is a mutable cache that find
+ * builds in place, so find is no safer to call alongside other threads than findOrAdd: in Task1 both are only called
+ * by whoever holds the store mutex exclusively, and LiveIndexes builds the map up front so that never takes long.
+ *
+ * Using int to automatically set the optimal size
+ */
+class StudentStore {
+public:
+    static constexpr StudentId notFound = UINT32_MAX;
+
+    inline StudentId size() const { return StudentId(names.size()); }
+
+    inline NameView name(StudentId id) const { return names[id]; }
+
+    inline int grade(StudentId id, int subject) const { return grades[subject][id]; }
+
+    inline void setGrade(StudentId id, int subject, int grade) { grades[subject][id] = grade; }
+
+    inline const std::vector<int> &column(int subject) const { return grades[subject]; }
+
+    inline const std::vector<NameView> &nameColumn() const { return names; }
+
+    // Builds the name to id map now rather than on the first lookup
+    void buildIdMap() const {
+        idMap();
+    }
+
+    StudentId find(const NameView &name) const {
+        auto iterator = idMap().find(name);
+        return iterator == ids.end() ? notFound : iterator->second;
+    }
+
+    // Returns the id of name, adding a student with all zero grades if it's new
+    StudentId findOrAdd(const NameView &name) {
+        idMap();
+        auto inserted = ids.emplace(name, size());
+        if (inserted.second) {
+            names.push_back(name);
+            for (auto &column : grades) {
+                column.push_back(0);
+            }
+        }
+        return inserted.first->second;
+    }
+
+    void reserve(size_t studentCount) {
+        names.reserve(studentCount);
+        for (auto &column : grades) {
+            column.reserve(studentCount);
+        }
+        ids.reserve(studentCount);
+    }
+
+    // Replaces everything with already built columns, names[id] and grades[subject][id] become student id
+    void assign(std::vector<NameView> &&newNames, std::array<std::vector<int>, 5> &&newGrades) {
+        names = std::move(newNames);
+        grades = std::move(newGrades);
+        ids.clear();
+        idsStale = true;
+    }
+
+    // The name to id map as it is right now, without building it
+    HashTableStats idMapStats() const {
+        HashTableStats stats;
+        if (idsStale) {
+            return stats;
+        }
+        stats.entries = ids.size();
+        stats.buckets = ids.bucket_count();
+        stats.loadFactor = ids.load_factor();
+        for (size_t bucket = 0; bucket < stats.buckets; bucket++) {
+            size_t chain = ids.bucket_size(bucket);
+            stats.usedBuckets += chain != 0;
+            stats.longestChain = std::max(stats.longestChain, chain);
+        }
+        return stats;
+    }
+
+    /*
+     * Bytes held by the columns and the name to id map. The map is estimated as a pointer per bucket plus a node per
+     * entry of the value, a next pointer and a cached hash, which is how libstdc++ lays them out.
+     */
+    size_t memoryBytes() const {
+        size_t bytes = names.capacity() * sizeof(NameView);
+        for (auto &column : grades) {
+            bytes += column.capacity() * sizeof(int);
+        }
+        if (!idsStale) {
+            bytes += ids.bucket_count() * sizeof(void *) +
+                     ids.size() * (sizeof(std::pair<const NameView, StudentId>) + sizeof(void *) + sizeof(size_t));
+        }
+        return bytes;
+    }
+
+    void computeTotals() {
+        for (StudentId id = 0; id < size(); id++) {
+            grades[4][id] = grades[0][id] + grades[1][id] + grades[2][id] + grades[3][id];
+        }
+    }
+
+    /*
+     * Appends every student of every part, in order, as new students. Each part gets a contiguous block of ids and is
+     * copied in on its own thread, and the name to id map is left for the first lookup. Nothing in parts may already be
+     * in this store.
+     */
+    void appendAll(std::vector<StudentStore> &parts) {
+        std::vector<StudentId> offsets{size()};
+        for (auto &part : parts) {
+            offsets.push_back(offsets.back() + part.size());
+        }
+        names.resize(offsets.back());
+        for (auto &column : grades) {
+            column.resize(offsets.back());
+        }
+        runOnThreads(unsigned(parts.size()), [&](unsigned i) {
+            std::copy(parts[i].names.begin(), parts[i].names.end(), names.begin() + offsets[i]);
+            for (int subject = 0; subject < 5; subject++) {
+                std::copy(parts[i].grades[subject].begin(), parts[i].grades[subject].end(),
+                          grades[subject].begin() + offsets[i]);
+            }
+        });
+        idsStale = true;
+    }
+
+private:
+    const std::unordered_map<NameView, StudentId, NameViewHash> &idMap() const {
+        if (idsStale) {
+            ids.clear();
+            ids.reserve(names.size());
+            for (StudentId id = 0; id < size(); id++) {
+                ids.emplace(names[id], id);
+            }
+            idsStale = false;
+        }
+        return ids;
+    }
+
+    std::vector<NameView> names;
+    std::array<std::vector<int>, 5> grades;
+    mutable std::unordered_map<NameView, StudentId, NameViewHash> ids;
+    mutable bool idsStale = false;
+};
+
+//Instead of making a switch statement for deciding which subject something is, use a map
+std::map<std::string, int> const subjectIndex(
+        {{"Biology",     0},
+         {"Mathematics", 1},
+         {"Chemistry",   2},
+         {"Physics",     3},
+         {"Total",       4}
+        }
+);
+
+// Allocation free version of subjectIndex.at() for tokens that are still inside a buffer. -1 if it isn't a subject
+inline int subjectFromToken(const char *begin, const char *end) {
+    static const char *const subjects[4]{"Biology", "Mathematics", "Chemistry", "Physics"};
+    size_t length = end - begin;
+    for (int i = 0; i < 4; i++) {
+        if (std::strlen(subjects[i]) == length && std::memcmp(subjects[i], begin, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * What a loader got through: lines it used and lines it skipped as malformed, and how long it spent parsing them and
+ * merging what it parsed into the store. The sequential loaders add students as they parse, so all they have left to
+ * merge is the totals. Only the line counts are added up by +=, the times are the whole loader's.
+ */
+struct LineCounts {
+    uint64_t parsed = 0;
+    uint64_t skipped = 0;
+    uint64_t parseNanoseconds = 0;
+    uint64_t mergeNanoseconds = 0;
+
+    LineCounts &operator+=(const LineCounts &other) {
+        parsed += other.parsed;
+        skipped += other.skipped;
+        return *this;
+    }
+};
+
+/*
+ * The original stream based loader. Kept so the mapped loader can be compared against it; names are copied into the
+ * arena the first time a student shows up.
+ */
+inline LineCounts loadInData(StudentStore &studentData, NameArena &arena, const std::string &fileLocation) {
+    auto start = std::chrono::steady_clock::now();
+    LineCounts counts;
+    //Each line consists of
+    // studentName subect grade
+    std::string studentName;
+    std::string subject;
+    std::string grade;
+    std::ifstream ifs(fileLocation);
+    //Until end of input
+    while (ifs.peek() != std::char_traits<char>::eof()) {
+        ifs >> studentName >> subject >> grade;
+        StudentId id = studentData.find(NameView(studentName));
+        if (id == StudentStore::notFound) {
+            id = studentData.findOrAdd(arena.intern(studentName));
+        }
+        studentData.setGrade(id, subjectIndex.at(subject), std::stoi(grade));
+        counts.parsed++;
+    }
+    counts.parseNanoseconds = elapsedNanoseconds(start);
+    start = std::chrono::steady_clock::now();
+    studentData.computeTotals();
+    counts.mergeNanoseconds = elapsedNanoseconds(start);
+    return counts;
+}
+
+/*
+ * Walks every "name subject grade" line in [pos, end) and calls onGrade(NameView, subject, grade) for it. The views
+ * point straight into the buffer. Lines that don't have a name, a known subject and a grade are skipped, and counted.
+ */
+template<class OnGrade>
+LineCounts forEachGradeLine(const char *pos, const char *end, OnGrade onGrade) {
+    LineCounts counts;
+    const char *nameEnd;
+    const char *subjectEnd;
+    int grade;
+    while ((pos = skipBlanks(pos, end)) < end) {
+        const char *name = scanToken(pos, end, nameEnd);
+        const char *subject = scanToken(nameEnd, end, subjectEnd);
+        int subjectNum = subjectFromToken(subject, subjectEnd);
+        const char *gradeEnd = subjectNum < 0 ? nullptr : scanInt(subjectEnd, end, grade);
+        if (gradeEnd) {
+            onGrade(NameView(name, uint32_t(nameEnd - name)), subjectNum, grade);
+            counts.parsed++;
+            pos = gradeEnd;
+        } else {
+            counts.skipped++;
+            pos = nameEnd;
+        }
+        // Anything else on the line is ignored
+        while (pos < end && *pos != '\n') {
+            pos++;
+        }
+    }
+    return counts;
+}
+
+/*
+ * Tokenises the mapped file in place. Names are views into the mapping, so the mapping has to outlive studentData.
+ */
+inline LineCounts loadInDataMapped(StudentStore &studentData, const MappedFile &file) {
+    auto addGrade = [&studentData](NameView name, int subject, int grade) {
+        studentData.setGrade(studentData.findOrAdd(name), subject, grade);
+    };
+    auto start = std::chrono::steady_clock::now();
+    LineCounts counts = forEachGradeLine(file.begin(), file.end(), addGrade);
+    counts.parseNanoseconds = elapsedNanoseconds(start);
+    start = std::chrono::steady_clock::now();
+    studentData.computeTotals();
+    counts.mergeNanoseconds = elapsedNanoseconds(start);
+    return counts;
+}
+
+/*
+ * What one chunk knows about a student. A chunk may only have seen some of a student's subjects, and a later chunk
+ * has to override an earlier one only for the subjects it actually saw, so that has to be remembered separately from
+ * the grade (a grade of 0 is valid).
+ */
+struct PartialStudent {
+    std::array<int, 4> grades;
+    uint8_t seen;
+};
+typedef std::unordered_map<NameView, PartialStudent, NameViewHash> partialDataStruct;
+
+/*
+ * Parallel version of loadInDataMapped, studentData is expected to start empty.
+ *
+ * The file is cut at line boundaries into one chunk per thread, and every thread builds its own tables for its chunk.
+ * Those tables are already split into partitions by name hash, so the merge can run one thread per partition without
+ * any locking: each merging thread walks its partition of every chunk in file order, lets later chunks override earlier
+ * ones subject by subject (exactly what the sequential loader does line by line) and fills in the Total on the way.
+ * The finished partitions are copied into the columns in parallel, and the store's own name to id map isn't built at
+ * all until something looks a name up in it.
+ */
+inline LineCounts loadInDataParallel(StudentStore &studentData, const MappedFile &file, unsigned threadCount) {
+    if (threadCount <= 1) {
+        return loadInDataMapped(studentData, file);
+    }
+    std::vector<const char *> bounds = splitAtLines(file.begin(), file.end(), threadCount);
+    unsigned partitionCount = threadCount;
+    NameViewHash hasher;
+    // The partition comes from the top bits so it doesn't line up with the bucket the tables pick from the bottom bits
+    auto partitionOf = [&hasher, partitionCount](const NameView &name) {
+        return unsigned((uint64_t(hasher(name)) >> 32) % partitionCount);
+    };
+
+    std::vector<std::vector<partialDataStruct>> chunkTables(threadCount,
+                                                            std::vector<partialDataStruct>(partitionCount));
+    std::vector<LineCounts> chunkCounts(threadCount);
+    auto start = std::chrono::steady_clock::now();
+    runOnThreads(threadCount, [&](unsigned chunk) {
+        std::vector<partialDataStruct> &tables = chunkTables[chunk];
+        auto addGrade = [&](NameView name, int subject, int grade) {
+            PartialStudent &student = tables[partitionOf(name)][name];
+            student.grades[subject] = grade;
+            student.seen |= uint8_t(1u << subject);
+        };
+        chunkCounts[chunk] = forEachGradeLine(bounds[chunk], bounds[chunk + 1], addGrade);
+    });
+    uint64_t parseNanoseconds = elapsedNanoseconds(start);
+    start = std::chrono::steady_clock::now();
+
+    std::vector<StudentStore> partitions(partitionCount);
+    runOnThreads(partitionCount, [&](unsigned partition) {
+        StudentStore &merged = partitions[partition];
+        for (unsigned chunk = 0; chunk < threadCount; chunk++) {
+            partialDataStruct &table = chunkTables[chunk][partition];
+            for (auto &entry : table) {
+                StudentId id = merged.findOrAdd(entry.first);
+                for (int subject = 0; subject < 4; subject++) {
+                    if (entry.second.seen & (1u << subject)) {
+                        merged.setGrade(id, subject, entry.second.grades[subject]);
+                    }
+                }
+            }
+            partialDataStruct().swap(table);
+        }
+        merged.computeTotals();
+    });
+    studentData.appendAll(partitions);
+    LineCounts counts;
+    for (auto &chunk : chunkCounts) {
+        counts += chunk;
+    }
+    counts.parseNanoseconds = parseNanoseconds;
+    counts.mergeNanoseconds = elapsedNanoseconds(start);
+    return counts;
+}
+
+#endif //PROJECT4_STUDENTDATA_H
@@ -0,0 +1,172 @@
+#ifndef PROJECT4_STUDENTSNAPSHOT_H
+#define PROJECT4_STUDENTSNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include "mappedFile.h"
+#include "studentData.h"
+#include "studentIndex.h"
+
+/*
+ * Binary snapshot of a loaded StudentStore and its sorted indexes, so a restart doesn't have to parse and sort again.
+ *
+ * Layout (native byte order, every section starts 8 byte aligned):
+ *      SnapshotHeader
+ *      uint64_t nameOffsets[studentCount + 1]  where each name starts in the name bytes, plus the end
+ *      char     nameBytes[nameBytes]           every name back to back, no separators
+ *      int32_t  grades[5][studentCount]        the five grade columns
+ *      uint32_t sortedData[6][studentCount]    the six sorted indexes
+ *
+ * The header remembers the size and modification time of the text file the snapshot was made from, and a snapshot
+ * whose source has changed since is treated as stale. Names are left inside the mapping when loading, so the mapping
+ * has to outlive the store.
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t studentCount;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t nameBytes;
+};
+
+const char snapshotMagic[8]{'P', '4', 'S', 'N', 'A', 'P', '\0', '\0'};
+const uint32_t snapshotVersion = 1;
+
+/*
+ * Writes the snapshot next to its final name first and renames it into place, so a reader never maps a half written
+ * file. Throws std::runtime_error if it can't be written.
+ */
+inline void writeSnapshot(const std::string &snapshotLocation, const std::string &sourceLocation,
+                          const StudentStore &studentData, const sortedDataStruct &sortedData) {
+    std::string temporary = snapshotLocation + ".tmp";
+    std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw std::runtime_error("Could not write " + temporary);
+    }
+    const char padding[8]{};
+    auto writePadded = [&](const void *data, size_t bytes) {
+        ofs.write(static_cast<const char *>(data), std::streamsize(bytes));
+        ofs.write(padding, std::streamsize(alignedTo8(bytes) - bytes));
+    };
+
+    StudentId studentCount = studentData.size();
+    std::vector<uint64_t> nameOffsets(studentCount + 1, 0);
+    for (StudentId id = 0; id < studentCount; id++) {
+        nameOffsets[id + 1] = nameOffsets[id] + studentData.name(id).length;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.studentCount = studentCount;
+    auto stamp = fileStamp(sourceLocation);
+    header.sourceSize = stamp.first;
+    header.sourceModified = stamp.second;
+    header.nameBytes = nameOffsets.back();
+    writePadded(&header, sizeof(header));
+
+    writePadded(nameOffsets.data(), nameOffsets.size() * sizeof(uint64_t));
+    for (StudentId id = 0; id < studentCount; id++) {
+        ofs.write(studentData.name(id).data, studentData.name(id).length);
+    }
+    ofs.write(padding, std::streamsize(alignedTo8(header.nameBytes) - header.nameBytes));
+    for (int subject = 0; subject < 5; subject++) {
+        writePadded(studentData.column(subject).data(), size_t(studentCount) * sizeof(int));
+    }
+    for (int index = 0; index < 6; index++) {
+        writePadded(sortedData[index].data(), size_t(studentCount) * sizeof(StudentId));
+    }
+
+    ofs.close();
+    if (!ofs || std::rename(temporary.c_str(), snapshotLocation.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write " + snapshotLocation);
+    }
+}
+
+/*
+ * Maps a snapshot and fills studentData and sortedData from it. Returns false, leaving both untouched, when there's no
+ * snapshot, it isn't one this version understands, it's damaged (names or indexes pointing outside it, an index that
+ * isn't every student once) or sourceLocation has changed since it was written. A missing source doesn't make it
+ * stale; the snapshot is all there is then.
+ */
+inline bool loadSnapshot(const std::string &snapshotLocation, const std::string &sourceLocation, MappedFile &mapping,
+                         StudentStore &studentData, sortedDataStruct &sortedData) {
+    MappedFile snapshot;
+    try {
+        snapshot = MappedFile(snapshotLocation);
+    } catch (std::runtime_error &) {
+        return false;
+    }
+    if (snapshot.size() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    SnapshotHeader header{};
+    std::memcpy(&header, snapshot.begin(), sizeof(header));
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 || header.version != snapshotVersion) {
+        return false;
+    }
+    auto stamp = fileStamp(sourceLocation);
+    if (fileExists(sourceLocation) && (stamp.first != header.sourceSize || stamp.second != header.sourceModified)) {
+        return false;
+    }
+
+    size_t studentCount = header.studentCount;
+    size_t offsetsAt = alignedTo8(sizeof(SnapshotHeader));
+    size_t namesAt = offsetsAt + alignedTo8((studentCount + 1) * sizeof(uint64_t));
+    size_t gradesAt = namesAt + alignedTo8(header.nameBytes);
+    size_t columnBytes = alignedTo8(studentCount * sizeof(int));
+    size_t indexesAt = gradesAt + 5 * columnBytes;
+    size_t indexBytes = alignedTo8(studentCount * sizeof(StudentId));
+    if (snapshot.size() != indexesAt + 6 * indexBytes) {
+        return false;
+    }
+
+    const char *base = snapshot.begin();
+    const uint64_t *nameOffsets = reinterpret_cast<const uint64_t *>(base + offsetsAt);
+    if (nameOffsets[studentCount] != header.nameBytes) {
+        return false;
+    }
+    std::vector<NameView> names(studentCount);
+    for (size_t id = 0; id < studentCount; id++) {
+        // A damaged file mustn't give a name that runs backwards or past the name bytes
+        if (nameOffsets[id] > nameOffsets[id + 1] || nameOffsets[id + 1] > header.nameBytes) {
+            return false;
+        }
+        names[id] = NameView(base + namesAt + nameOffsets[id], uint32_t(nameOffsets[id + 1] - nameOffsets[id]));
+    }
+    // Every index has to be every id once, or a damaged file would have the indexes read past the columns
+    std::vector<uint64_t> seen((studentCount + 63) / 64);
+    for (int index = 0; index < 6; index++) {
+        const StudentId *ids = reinterpret_cast<const StudentId *>(base + indexesAt + index * indexBytes);
+        std::fill(seen.begin(), seen.end(), 0);
+        for (size_t i = 0; i < studentCount; i++) {
+            uint64_t bit = uint64_t(1) << (ids[i] % 64);
+            if (ids[i] >= studentCount || (seen[ids[i] / 64] & bit)) {
+                return false;
+            }
+            seen[ids[i] / 64] |= bit;
+        }
+    }
+    std::array<std::vector<int>, 5> grades;
+    for (int subject = 0; subject < 5; subject++) {
+        const int *column = reinterpret_cast<const int *>(base + gradesAt + subject * columnBytes);
+        grades[subject].assign(column, column + studentCount);
+    }
+    for (int index = 0; index < 6; index++) {
+        const StudentId *ids = reinterpret_cast<const StudentId *>(base + indexesAt + index * indexBytes);
+        sortedData[index].assign(ids, ids + studentCount);
+    }
+    studentData.assign(std::move(names), std::move(grades));
+    mapping = std::move(snapshot);
+    return true;
+}
+
+#endif //PROJECT4_STUDENTSNAPSHOT_H
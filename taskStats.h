@@ -0,0 +1,235 @@
+#ifndef PROJECT4_TASKSTATS_H
+#define PROJECT4_TASKSTATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <sys/resource.h>
+#include "studentData.h"
+#include "studentIndex.h"
+#include "gradeQuery.h"
+#include "resultWriter.h"
+#include "gradeStats.h"
+
+/*
+ * Latencies in power of two nanosecond buckets: bucket b counts everything in [2^b, 2^(b+1)). Recording is a couple of
+ * relaxed atomic adds, so any number of threads can record at once, and percentiles come out as the top of a bucket,
+ * which is never off by more than a factor of two.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int bucketCount = 48;
+
+    void record(uint64_t nanoseconds) {
+        int bucket = nanoseconds == 0 ? 0 : 63 - __builtin_clzll(nanoseconds);
+        counts[bucket < bucketCount ? bucket : bucketCount - 1].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(nanoseconds, std::memory_order_relaxed);
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (nanoseconds > seen && !largest.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const {
+        uint64_t sum = 0;
+        for (auto &bucket : counts) {
+            sum += bucket.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    inline uint64_t totalNanoseconds() const { return total.load(std::memory_order_relaxed); }
+
+    inline uint64_t maximum() const { return largest.load(std::memory_order_relaxed); }
+
+    // The top of the bucket the p-th percentile (0 to 100) falls in
+    uint64_t percentile(double p) const {
+        uint64_t wanted = uint64_t(p / 100 * double(count()) + 0.5);
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < bucketCount; bucket++) {
+            seen += counts[bucket].load(std::memory_order_relaxed);
+            if (seen >= wanted && seen > 0) {
+                return std::min((uint64_t(2) << bucket) - 1, maximum());
+            }
+        }
+        return maximum();
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, bucketCount> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> largest{0};
+};
+
+// What StudentCommands keeps latencies for, one histogram each
+enum class CommandKind {
+    listing, until, count, query, find, nameSearch, statistics, other
+};
+const int commandKindCount = 8;
+const char *const commandKindNames[commandKindCount]{"listing", "until", "count", "compound query", "find",
+                                                      "prefix/range", "summary/percentile/histogram", "other"};
+
+/*
+ * Counters and timers for what Task1 has been doing, cheap enough to leave on all the time: the load records its
+ * counts once, and every command adds its latency and output size with relaxed atomics. print() puts them together
+ * with what the indexes and the store report about themselves, which is what the stats command shows.
+ */
+class TaskStats {
+public:
+    explicit TaskStats(const NameArena &arena) : arena(arena) {}
+
+    TaskStats(const TaskStats &) = delete;
+
+    TaskStats &operator=(const TaskStats &) = delete;
+
+    /*
+     * source is what was loaded ("text", "legacy text" or "snapshot"), inputBytes how big it was and mappedBytes how
+     * much of it is mapped rather than copied, which is none of it for the legacy stream loader
+     */
+    void recordLoad(const std::string &source, const LineCounts &counts, uint64_t nanoseconds, uint64_t inputBytes,
+                    uint64_t mappedBytes) {
+        loadSource = source;
+        input = inputBytes;
+        lines = counts;
+        loadNanoseconds = nanoseconds;
+        mapped = mappedBytes;
+    }
+
+    // nanoseconds includes lockWaitNanoseconds, the time spent waiting for the store's read lock
+    void recordCommand(CommandKind kind, uint64_t nanoseconds, uint64_t lockWaitNanoseconds, uint64_t bytesOut) {
+        latencies[int(kind)].record(nanoseconds);
+        lockWaits.record(lockWaitNanoseconds);
+        outputBytes[int(kind)].fetch_add(bytesOut, std::memory_order_relaxed);
+    }
+
+    void print(ResultWriter &out, const StudentStore &studentData, const LazyIndexes &sortedIndexes,
+               const GradeQueryIndex &queryIndex) const {
+        out << "Load: " << loadSource << " in " << milliseconds(loadNanoseconds) << "ms";
+        if (lines.parseNanoseconds + lines.mergeNanoseconds > 0) {
+            out << " (parse " << milliseconds(lines.parseNanoseconds) << "ms, merge "
+                << milliseconds(lines.mergeNanoseconds) << "ms)";
+        }
+        out << " | bytes: " << input << " | lines parsed: " << lines.parsed << " | lines skipped: " << lines.skipped
+            << " | students: " << studentData.size() << '\n';
+
+        HashTableStats table = studentData.idMapStats();
+        if (table.buckets == 0) {
+            out << "Name hash table: not built\n";
+        } else {
+            out << "Name hash table: " << table.entries << " entries | " << table.buckets << " buckets | load factor: "
+                << table.loadFactor << " | used buckets: " << table.usedBuckets << " | longest chain: "
+                << table.longestChain << '\n';
+        }
+
+        out << "Index build times (ms):";
+        for (int index = 0; index < 6; index++) {
+            out << ' ' << (index == namesIndex ? "Names" : subjectNames[index]) << ' ';
+            if (sortedIndexes.isBuilt(index)) {
+                out << milliseconds(sortedIndexes.buildTime(index));
+            } else {
+                out << '-';
+            }
+        }
+        out << "\nQuery index build times (ms):";
+        for (int subject = 0; subject < 5; subject++) {
+            out << ' ' << subjectNames[subject] << ' ' << milliseconds(queryIndex.buildTime(subject));
+        }
+
+        out << "\nMemory (bytes): store " << studentData.memoryBytes() << " | sorted indexes "
+            << sortedIndexes.memoryBytes() << " | query indexes " << queryIndex.memoryBytes() << " | name arena "
+            << arena.memoryBytes() << " | mapped " << mapped << " | peak RSS " << peakResidentBytes() << '\n';
+
+        out << "Commands (latency in us):\n";
+        for (int kind = 0; kind < commandKindCount; kind++) {
+            const LatencyHistogram &latency = latencies[kind];
+            uint64_t count = latency.count();
+            if (count == 0) {
+                continue;
+            }
+            out << "  " << commandKindNames[kind] << ": " << count << " | mean "
+                << double(latency.totalNanoseconds()) / double(count) / 1e3 << " | p50 "
+                << double(latency.percentile(50)) / 1e3 << " | p90 " << double(latency.percentile(90)) / 1e3
+                << " | p99 " << double(latency.percentile(99)) / 1e3 << " | max " << double(latency.maximum()) / 1e3
+                << " | output bytes " << outputBytes[kind].load(std::memory_order_relaxed) << '\n';
+        }
+        uint64_t waits = lockWaits.count();
+        if (waits > 0) {
+            out << "  read lock wait: " << waits << " | mean "
+                << double(lockWaits.totalNanoseconds()) / double(waits) / 1e3 << " | p99 "
+                << double(lockWaits.percentile(99)) / 1e3 << " | max " << double(lockWaits.maximum()) / 1e3 << '\n';
+        }
+    }
+
+private:
+    static double milliseconds(uint64_t nanoseconds) {
+        return double(nanoseconds) / 1e6;
+    }
+
+    // ru_maxrss is in kilobytes on Linux
+    static uint64_t peakResidentBytes() {
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return uint64_t(usage.ru_maxrss) * 1024;
+    }
+
+    const NameArena &arena;
+    std::string loadSource = "nothing";
+    LineCounts lines;
+    uint64_t loadNanoseconds = 0;
+    uint64_t input = 0;
+    uint64_t mapped = 0;
+    std::array<LatencyHistogram, commandKindCount> latencies;
+    // Every command's, whatever its kind
+    LatencyHistogram lockWaits;
+    std::array<std::atomic<uint64_t>, commandKindCount> outputBytes{};
+};
+
+/*
+ * Calls write with a writer into fileLocation every period, on its own thread, replacing the file each time. Stops
+ * (without a last write) when it goes out of scope.
+ */
+class PeriodicStatsDump {
+public:
+    PeriodicStatsDump(const std::string &fileLocation, std::chrono::seconds period,
+                      std::function<void(ResultWriter &)> write)
+            : fileLocation(fileLocation), period(period), write(std::move(write)) {
+        worker = std::thread(&PeriodicStatsDump::run, this);
+    }
+
+    ~PeriodicStatsDump() {
+        stopping = true;
+        worker.join();
+    }
+
+    PeriodicStatsDump(const PeriodicStatsDump &) = delete;
+
+    PeriodicStatsDump &operator=(const PeriodicStatsDump &) = delete;
+
+private:
+    void run() {
+        auto next = std::chrono::steady_clock::now() + period;
+        while (!stopping) {
+            // Short sleeps so going out of scope doesn't wait a whole period
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (std::chrono::steady_clock::now() < next) {
+                continue;
+            }
+            next += period;
+            std::ofstream ofs(fileLocation, std::ios::trunc);
+            ResultWriter out(&ofs);
+            write(out);
+        }
+    }
+
+    std::string fileLocation;
+    std::chrono::seconds period;
+    std::function<void(ResultWriter &)> write;
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
+
+#endif //PROJECT4_TASKSTATS_H
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <array>
 #include <stack>
+#include <iterator>
 
 // Defining the generator function
 struct generator {
@@ -19,8 +20,8 @@ struct generator {
 template<typename T>
 double testSort(T &data) {
     clock_t startTime = clock();
-    std::generate(data.begin(), data.end(), generator());
-    std::sort(data.begin(), data.end());
+    std::generate(std::begin(data), std::end(data), generator());
+    std::sort(std::begin(data), std::end(data));
     return double(clock() - startTime) / CLOCKS_PER_SEC;
 }
 